@@ -0,0 +1,82 @@
+#include "Assembler.h"
+
+static int compare_symbols(const void *a, const void *b) {
+    const Hack_Symbol *x = a;
+    const Hack_Symbol *y = b;
+    if (x->kind != y->kind) return x->kind < y->kind ? -1 : 1;
+    if (x->address != y->address) return x->address < y->address ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+Hack_Symbol *symbol_map(const HashTable *t, size_t *count) {
+    Hack_Symbol *symbols = malloc((t->count + 1) * sizeof(Hack_Symbol));
+    assert(symbols != NULL && "More RAM!");
+
+    size_t n = 0;
+    for (size_t i = 0; i < t->T; ++i) {
+        const Entry *e = &t->table[i];
+        if (e->key == NULL) continue;
+        symbols[n].name = e->key;
+        symbols[n].address = (uint16_t)e->address;
+        symbols[n].kind = e->kind;
+        n++;
+    }
+    qsort(symbols, n, sizeof(Hack_Symbol), compare_symbols);
+
+    *count = n;
+    return symbols;
+}
+
+int write_symbol_map(const HashTable *t, const char *path) {
+    char *map_filename = output_name(path, ".sym");
+    if (!map_filename) { perror("Invalid filename."); return -1; }
+
+    Writer out;
+    if (!writer_open(&out, map_filename, false)) {
+        perror("Error opening file (symbols)");
+        free(map_filename);
+        return -1;
+    }
+    free(map_filename);
+
+    size_t count;
+    Hack_Symbol *symbols = symbol_map(t, &count);
+    for (size_t i = 0; i < count; ++i) {
+        if (symbols[i].kind == SYMBOL_PREDEFINED) continue;
+        char line[8];
+        snprintf(line, sizeof(line), "%c %04X ", symbols[i].kind == SYMBOL_LABEL ? 'L' : 'V', symbols[i].address);
+        writer_write(&out, line, 7);
+        writer_write(&out, symbols[i].name, strlen(symbols[i].name));
+        writer_write(&out, "\n", 1);
+    }
+    free(symbols);
+
+    if (!writer_close(&out)) { perror("Error writing file (symbols)"); return -1; }
+    return 0;
+}
+
+int hack_assemble(const char *source, size_t size, Hack_Program *program) {
+    *program = (Hack_Program){0};
+
+    program->table = create_table();
+    if (!program->table) return -1;
+
+    Rom rom = {0};
+    if (assemble_source(program->table, sv_from_parts(source, size), &rom) < 0) {
+        da_free(rom);
+        hack_program_free(program);
+        return -1;
+    }
+
+    program->rom = rom.items;
+    program->rom_count = rom.count;
+    program->symbols = symbol_map(program->table, &program->symbol_count);
+    return 0;
+}
+
+void hack_program_free(Hack_Program *program) {
+    free(program->rom);
+    free(program->symbols);
+    free_table(program->table);
+    *program = (Hack_Program){0};
+}
\ No newline at end of file
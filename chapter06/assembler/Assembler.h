@@ -0,0 +1,36 @@
+#ifndef ASSEMBLER_H_
+#define ASSEMBLER_H_
+
+#include "Parser.h"
+
+// In-memory assembler: assembly text in, ROM words and symbols out.
+// Reentrant: everything lives in the Hack_Program, so it can run on many threads at once.
+
+typedef struct {
+    const char *name;
+    uint16_t address;   // ROM address for labels, RAM address otherwise
+    Symbol_Kind kind;
+} Hack_Symbol;
+
+typedef struct {
+    uint16_t *rom;
+    size_t rom_count;
+    Hack_Symbol *symbols;   // sorted by kind, then by address
+    size_t symbol_count;
+
+    HashTable *table;       // owns the symbol names
+} Hack_Program;
+
+// Assembles size bytes of Hack assembly. Returns 0 on success, -1 on error.
+int hack_assemble(const char *source, size_t size, Hack_Program *program);
+void hack_program_free(Hack_Program *program);
+
+// Symbols of a table, sorted by kind, then by address, then by name. Names point into the table.
+Hack_Symbol *symbol_map(const HashTable *t, size_t *count);
+
+// Writes the .sym map next to the .asm file: every label with its ROM address and every variable
+// with its RAM address, one per line as "<L|V> <4 hex digits> <name>", labels first, each kind
+// sorted by address. The fixed-width lines let a profiler binary search the label of a PC.
+int write_symbol_map(const HashTable *t, const char *path);
+
+#endif // ASSEMBLER_H_
\ No newline at end of file
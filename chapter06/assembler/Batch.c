@@ -0,0 +1,111 @@
+#include "Batch.h"
+
+typedef struct {
+    const HashTable *predefined;
+    Batch_Job *jobs;
+    size_t count;
+    size_t next;
+    Mutex lock;
+    Output_Format format;
+    bool symbols;
+} Batch;
+
+static void batch_worker(void *arg) {
+    Batch *b = arg;
+    for (;;) {
+        mutex_lock(&b->lock);
+        size_t i = b->next++;
+        mutex_unlock(&b->lock);
+        if (i >= b->count) return;
+
+        Batch_Job *job = &b->jobs[i];
+        double start = now_seconds();
+        HashTable *t = clone_table(b->predefined);
+        if (!t) {
+            job->result = -1;
+        } else {
+            job->result = assembler_single_pass(t, job->path, b->format);
+            if (job->result == 0 && b->symbols) job->result = write_symbol_map(t, job->path);
+            job->instructions = t->rom;
+            free_table(t);
+        }
+        job->seconds = now_seconds() - start;
+    }
+}
+
+static void batch_report(const Batch_Job *jobs, size_t count, int threads, double wall) {
+    size_t failed = 0, instructions = 0;
+    double busy = 0;
+    const Batch_Job *slowest = NULL;
+
+    for (size_t i = 0; i < count; ++i) {
+        const Batch_Job *job = &jobs[i];
+        if (job->result < 0) {
+            failed++;
+            printf("FAILED  %s\n", job->path);
+            continue;
+        }
+        instructions += job->instructions;
+        busy += job->seconds;
+        if (!slowest || job->seconds > slowest->seconds) slowest = job;
+    }
+
+    printf("Files:        %zu assembled, %zu failed\n", count - failed, failed);
+    printf("Workers:      %d\n", threads);
+    printf("Instructions: %zu\n", instructions);
+    printf("Wall time:    %.3f ms\n", wall * 1e3);
+    printf("Worker time:  %.3f ms (%.2fx parallelism)\n", busy * 1e3, wall > 0 ? busy / wall : 0.0);
+    if (wall > 0) printf("Throughput:   %.0f instructions/s, %.1f files/s\n", instructions / wall, count / wall);
+    if (slowest) printf("Slowest:      %s (%.3f ms, %zu instructions)\n", slowest->path, slowest->seconds * 1e3, slowest->instructions);
+}
+
+int assemble_batch(char **paths, size_t count, Output_Format format, int threads, bool symbols) {
+    if (count == 0) return 0;
+    if (threads <= 0) threads = cpu_count();
+    if ((size_t)threads > count) threads = (int)count;
+
+    HashTable *predefined = create_table();
+    if (!predefined) {
+        perror("Error creating Symbol Table.");
+        return (int)count;
+    }
+
+    Batch b = {0};
+    b.predefined = predefined;
+    b.count = count;
+    b.format = format;
+    b.symbols = symbols;
+    b.jobs = calloc(count, sizeof(Batch_Job));
+    Thread *workers = calloc((size_t)threads, sizeof(Thread));
+    if (!b.jobs || !workers) {
+        free(b.jobs);
+        free(workers);
+        free_table(predefined);
+        return (int)count;
+    }
+    for (size_t i = 0; i < count; ++i) b.jobs[i].path = paths[i];
+    mutex_init(&b.lock);
+
+    double start = now_seconds();
+
+    // the calling thread is worker 0
+    int started = 1;
+    for (int i = 1; i < threads; ++i) {
+        if (!thread_start(&workers[i], batch_worker, &b)) break;
+        started++;
+    }
+    batch_worker(&b);
+    for (int i = 1; i < started; ++i) thread_join(workers[i]);
+
+    double wall = now_seconds() - start;
+    batch_report(b.jobs, count, started, wall);
+
+    int failed = 0;
+    for (size_t i = 0; i < count; ++i) if (b.jobs[i].result < 0) failed++;
+
+    mutex_destroy(&b.lock);
+    free(workers);
+    free(b.jobs);
+    free_table(predefined);
+    return failed;
+}
@@ -0,0 +1,21 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include "Assembler.h"
+
+// Result of one file of a batch
+typedef struct {
+    const char *path;
+    int result;          // 0 or -1, like assembler_single_pass()
+    size_t instructions; // ROM words emitted
+    double seconds;      // time spent by the worker on this file
+} Batch_Job;
+
+// Assembles many independent .asm files with a pool of worker threads (threads <= 0: one per core).
+// The predefined symbols are built once and every job starts from a clone of them; the mnemonic
+// tables of Code.c are constant and shared as they are. Each file is assembled with the single-pass
+// assembler and written next to its source. Prints an aggregate timing report to stdout.
+// With symbols, the .sym map of every file is written too. Returns the number of files that failed.
+int assemble_batch(char **paths, size_t count, Output_Format format, int threads, bool symbols);
+
+#endif // BATCH_H_
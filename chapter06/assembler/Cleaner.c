@@ -0,0 +1,150 @@
+#include "Cleaner.h"
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#    define CLEAN_WIDTH 32
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#    include <emmintrin.h>
+#    define CLEAN_WIDTH 16
+#endif
+
+typedef struct {
+    bool comment;    // inside a comment: everything up to the next '\n' is dropped
+    bool line_empty; // nothing written yet for the current line
+} Clean_State;
+
+static bool is_blank(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r'); // same set as isspace() in the "C" locale
+}
+
+static char *clean_bytes(Clean_State *st, char *out, const char *p, const char *end) {
+    for (; p < end; ++p) {
+        char c = *p;
+        if (c == '\n') {
+            st->comment = false;
+            if (!st->line_empty) { *out++ = '\n'; st->line_empty = true; }
+        } else if (st->comment || is_blank(c)) {
+            continue;
+        } else if (c == '/' && p + 1 < end && p[1] == '/') {
+            st->comment = true;
+        } else {
+            *out++ = c;
+            st->line_empty = false;
+        }
+    }
+    return out;
+}
+
+static String_View clean_finish(Clean_State *st, char *out, String_Builder *sb) {
+    if (!st->line_empty) *out++ = '\n';
+    sb->count = (size_t)(out - sb->items);
+    return sb_to_sv(*sb);
+}
+
+String_View clean_source_scalar(String_View source, String_Builder *out) {
+    out->count = 0;
+    da_reserve(out, source.count + CLEAN_SLACK);
+    Clean_State st = {false, true};
+    char *end = clean_bytes(&st, out->items, source.data, source.data + source.count);
+    return clean_finish(&st, end, out);
+}
+
+#ifdef CLEAN_WIDTH
+
+static unsigned ctz32(uint32_t x) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (unsigned)i;
+#else
+    return (unsigned)__builtin_ctz(x);
+#endif
+}
+
+// One block given the masks of its '\n' and of all its bytes that are not copied as they are
+// (whitespace, '\n' and '/'). Runs between special bytes are copied with a fixed-size memcpy
+// from the padded copy of the block, the extra bytes land in the slack of out.
+static char *clean_block(Clean_State *st, char *out, const char *block, const char *padded,
+                         const char *end, uint32_t nl, uint32_t special) {
+    unsigned pos = 0;
+    while (pos < CLEAN_WIDTH) {
+        if (st->comment) {
+            uint32_t rest = nl >> pos;
+            if (rest == 0) return out;
+            pos += ctz32(rest); // the '\n' itself is handled below
+            st->comment = false;
+        }
+
+        uint32_t rest = special >> pos;
+        unsigned s = rest ? pos + ctz32(rest) : CLEAN_WIDTH;
+        if (s > pos) {
+            memcpy(out, padded + pos, CLEAN_WIDTH);
+            out += s - pos;
+            st->line_empty = false;
+        }
+        if (s == CLEAN_WIDTH) return out;
+
+        char c = block[s];
+        if (c == '\n') {
+            if (!st->line_empty) { *out++ = '\n'; st->line_empty = true; }
+        } else if (c == '/') {
+            if (block + s + 1 < end && block[s + 1] == '/') st->comment = true;
+            else { *out++ = '/'; st->line_empty = false; }
+        }
+        pos = s + 1;
+    }
+    return out;
+}
+
+String_View clean_source(String_View source, String_Builder *out) {
+    out->count = 0;
+    da_reserve(out, source.count + CLEAN_SLACK);
+    Clean_State st = {false, true};
+
+    const char *p = source.data;
+    const char *end = source.data + source.count;
+    char *o = out->items;
+    char padded[2*CLEAN_WIDTH] = {0};
+
+    for (; end - p >= CLEAN_WIDTH; p += CLEAN_WIDTH) {
+#if CLEAN_WIDTH == 32
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i ctl = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+        ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(ctl, _mm256_set1_epi8('\r' - '\t')), ctl);
+        uint32_t nl = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        uint32_t special = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(ctl, _mm256_or_si256(
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')))));
+#else
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i ctl = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+        ctl = _mm_cmpeq_epi8(_mm_min_epu8(ctl, _mm_set1_epi8('\r' - '\t')), ctl);
+        uint32_t nl = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        uint32_t special = (uint32_t)_mm_movemask_epi8(_mm_or_si128(ctl, _mm_or_si128(
+            _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('/')))));
+#endif
+
+        if (st.comment && nl == 0) continue;
+
+        // plain instructions separated by single '\n': the block is already clean
+        if (!st.comment && (special & ~nl) == 0 && (nl & ((nl << 1) | st.line_empty)) == 0) {
+            memcpy(o, p, CLEAN_WIDTH);
+            o += CLEAN_WIDTH;
+            st.line_empty = (nl >> (CLEAN_WIDTH - 1)) & 1;
+            continue;
+        }
+
+        memcpy(padded, p, CLEAN_WIDTH);
+        o = clean_block(&st, o, p, padded, end, nl, special);
+    }
+
+    o = clean_bytes(&st, o, p, end);
+    return clean_finish(&st, o, out);
+}
+
+#else
+
+String_View clean_source(String_View source, String_Builder *out) {
+    return clean_source_scalar(source, out);
+}
+
+#endif // CLEAN_WIDTH
@@ -0,0 +1,18 @@
+#ifndef CLEANER_H_
+#define CLEANER_H_
+
+#include "Utils.h"
+
+// Bytes written past the end of the cleaned text by the vector kernels
+#define CLEAN_SLACK 64
+
+// Normalizes a whole .asm source in one pass: comments ("//" up to the end of the line) and all
+// whitespace are removed and empty lines are dropped, so every line of the result is exactly one
+// instruction or label, terminated by '\n'. The text is kept in out (reset first); the returned
+// view points into it. Uses AVX2 or SSE2 when the compiler targets them, scalar code otherwise.
+String_View clean_source(String_View source, String_Builder *out);
+
+// Same result, byte by byte: the fallback of clean_source() and its reference in the benchmark
+String_View clean_source_scalar(String_View source, String_Builder *out);
+
+#endif // CLEANER_H_
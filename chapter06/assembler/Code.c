@@ -1,91 +1,107 @@
-#include <string.h>
-#include <stdio.h>
-
 #include "Code.h"
-#include "SymbolTable.h"
 
-static HashTable *dest_table;
-static HashTable *comp_table;
-static HashTable *jump_table;
+// Mnemonics of up to 3 characters are packed, together with their length, into a single
+// integer, so the translation is a switch on integer constants: no hashing, no strcmp.
+#define K1(a)       ((uint32_t)(unsigned char)(a) | 1u << 24)
+#define K2(a, b)    ((uint32_t)(unsigned char)(a) | (uint32_t)(unsigned char)(b) << 8 | 2u << 24)
+#define K3(a, b, c) ((uint32_t)(unsigned char)(a) | (uint32_t)(unsigned char)(b) << 8 | \
+                     (uint32_t)(unsigned char)(c) << 16 | 3u << 24)
+#define K_INVALID   0u
 
-int create_mnemonic_tables() {
-    // dest
-    dest_table = create_table();
-    if (!dest_table) {
-        perror("Error creating Dest Mnemonic Table.");
-        return -1;
+static uint32_t pack(String_View sv) {
+    switch (sv.count) {
+        case 1: return K1(sv.data[0]);
+        case 2: return K2(sv.data[0], sv.data[1]);
+        case 3: return K3(sv.data[0], sv.data[1], sv.data[2]);
+        default: return K_INVALID;
     }
+}
 
-    add_entry(dest_table, "NULL", 0b000);
-    add_entry(dest_table,    "M", 0b001);
-    add_entry(dest_table,    "D", 0b010);
-    add_entry(dest_table,   "MD", 0b011);
-    add_entry(dest_table,    "A", 0b100);
-    add_entry(dest_table,   "AM", 0b101);
-    add_entry(dest_table,   "AD", 0b110);
-    add_entry(dest_table,  "AMD", 0b111);
-
-    // comp
-    comp_table = create_table();
-    if (!comp_table) {
-        perror("Error creating Comp Mnemonic Table.");
-        return -1;
-    }
+// comp
+#define COMP_TABLE(X)                       \
+    X(  "0", K1('0'),           0b0101010)  \
+    X(  "1", K1('1'),           0b0111111)  \
+    X( "-1", K2('-', '1'),      0b0111010)  \
+    X(  "D", K1('D'),           0b0001100)  \
+    X(  "A", K1('A'),           0b0110000)  \
+    X(  "M", K1('M'),           0b1110000)  \
+    X( "!D", K2('!', 'D'),      0b0001101)  \
+    X( "!A", K2('!', 'A'),      0b0110001)  \
+    X( "!M", K2('!', 'M'),      0b1110001)  \
+    X( "-D", K2('-', 'D'),      0b0001111)  \
+    X( "-A", K2('-', 'A'),      0b0110011)  \
+    X( "-M", K2('-', 'M'),      0b1110011)  \
+    X("D+1", K3('D', '+', '1'), 0b0011111)  \
+    X("A+1", K3('A', '+', '1'), 0b0110111)  \
+    X("M+1", K3('M', '+', '1'), 0b1110111)  \
+    X("D-1", K3('D', '-', '1'), 0b0001110)  \
+    X("A-1", K3('A', '-', '1'), 0b0110010)  \
+    X("M-1", K3('M', '-', '1'), 0b1110010)  \
+    X("D+A", K3('D', '+', 'A'), 0b0000010)  \
+    X("D+M", K3('D', '+', 'M'), 0b1000010)  \
+    X("D-A", K3('D', '-', 'A'), 0b0010011)  \
+    X("D-M", K3('D', '-', 'M'), 0b1010011)  \
+    X("A-D", K3('A', '-', 'D'), 0b0000111)  \
+    X("M-D", K3('M', '-', 'D'), 0b1000111)  \
+    X("D&A", K3('D', '&', 'A'), 0b0000000)  \
+    X("D&M", K3('D', '&', 'M'), 0b1000000)  \
+    X("D|A", K3('D', '|', 'A'), 0b0010101)  \
+    X("D|M", K3('D', '|', 'M'), 0b1010101)  \
 
-    add_entry(comp_table,   "0", 0b0101010);
-    add_entry(comp_table,   "1", 0b0111111);
-    add_entry(comp_table,  "-1", 0b0111010);
-    add_entry(comp_table,   "D", 0b0001100);
-    add_entry(comp_table,   "A", 0b0110000);
-    add_entry(comp_table,   "M", 0b1110000);
-    add_entry(comp_table,  "!D", 0b0001101);
-    add_entry(comp_table,  "!A", 0b0110001);
-    add_entry(comp_table,  "!M", 0b1110001);
-    add_entry(comp_table,  "-D", 0b0001111);
-    add_entry(comp_table,  "-A", 0b0110011);
-    add_entry(comp_table,  "-M", 0b1110011);
-    add_entry(comp_table, "D+1", 0b0011111);
-    add_entry(comp_table, "A+1", 0b0110111);
-    add_entry(comp_table, "M+1", 0b1110111);
-    add_entry(comp_table, "D-1", 0b0001110);
-    add_entry(comp_table, "A-1", 0b0110010);
-    add_entry(comp_table, "M-1", 0b1110010);
-    add_entry(comp_table, "D+A", 0b0000010);
-    add_entry(comp_table, "D+M", 0b1000010);
-    add_entry(comp_table, "D-A", 0b0010011);
-    add_entry(comp_table, "D-M", 0b1010011);
-    add_entry(comp_table, "A-D", 0b0000111);
-    add_entry(comp_table, "M-D", 0b1000111);
-    add_entry(comp_table, "D&A", 0b0000000);
-    add_entry(comp_table, "D&M", 0b1000000);
-    add_entry(comp_table, "D|A", 0b0010101);
-    add_entry(comp_table, "D|M", 0b1010101);
+// jump
+#define JUMP_TABLE(X)                       \
+    X("JGT", K3('J', 'G', 'T'), 0b001)      \
+    X("JEQ", K3('J', 'E', 'Q'), 0b010)      \
+    X("JGE", K3('J', 'G', 'E'), 0b011)      \
+    X("JLT", K3('J', 'L', 'T'), 0b100)      \
+    X("JNE", K3('J', 'N', 'E'), 0b101)      \
+    X("JLE", K3('J', 'L', 'E'), 0b110)      \
+    X("JMP", K3('J', 'M', 'P'), 0b111)      \
 
-    // jump
-    jump_table = create_table();
-    if (!jump_table) {
-        perror("Error creating Jump Mnemonic Table.");
-        return -1;
-    }
+#define MNEMONIC_ENTRY(name, key, bits) { name, bits },
+#define MNEMONIC_CASE(name, key, bits) case key: return bits;
 
-    add_entry(jump_table, "NULL", 0b000);
-    add_entry(jump_table,  "JGT", 0b001);
-    add_entry(jump_table,  "JEQ", 0b010);
-    add_entry(jump_table,  "JGE", 0b011);
-    add_entry(jump_table,  "JLT", 0b100);
-    add_entry(jump_table,  "JNE", 0b101);
-    add_entry(jump_table,  "JLE", 0b110);
-    add_entry(jump_table,  "JMP", 0b111);
+const Mnemonic dest_mnemonics[] = {
+    {   "", 0b000 },
+    {  "M", 0b001 },
+    {  "D", 0b010 },
+    { "MD", 0b011 },
+    {  "A", 0b100 },
+    { "AM", 0b101 },
+    { "AD", 0b110 },
+    {"AMD", 0b111 },
+};
+const Mnemonic comp_mnemonics[] = { COMP_TABLE(MNEMONIC_ENTRY) };
+const Mnemonic jump_mnemonics[] = { {"", 0b000}, JUMP_TABLE(MNEMONIC_ENTRY) };
+const size_t dest_mnemonics_count = sizeof(dest_mnemonics) / sizeof(dest_mnemonics[0]);
+const size_t comp_mnemonics_count = sizeof(comp_mnemonics) / sizeof(comp_mnemonics[0]);
+const size_t jump_mnemonics_count = sizeof(jump_mnemonics) / sizeof(jump_mnemonics[0]);
 
-    return 0;
+int code_dest(String_View mnemonic) {
+    // any combination of A, D and M: each register is one bit
+    int bits = 0;
+    for (size_t i = 0; i < mnemonic.count; ++i) {
+        switch (mnemonic.data[i]) {
+            case 'A': bits |= 0b100; break;
+            case 'D': bits |= 0b010; break;
+            case 'M': bits |= 0b001; break;
+            default: return -1;
+        }
+    }
+    return bits;
 }
 
-void free_mnemonic_tables() {
-    free_table(dest_table);
-    free_table(comp_table);
-    free_table(jump_table);
+int code_comp(String_View mnemonic) {
+    switch (pack(mnemonic)) {
+        COMP_TABLE(MNEMONIC_CASE)
+        default: return -1;
+    }
 }
 
-int code_dest(unsigned char *mnemonic) { return get_address(dest_table, mnemonic); }
-int code_comp(unsigned char *mnemonic) { return get_address(comp_table, mnemonic); }
-int code_jump(unsigned char *mnemonic) { return get_address(jump_table, mnemonic); }
\ No newline at end of file
+int code_jump(String_View mnemonic) {
+    if (mnemonic.count == 0) return 0b000;
+    switch (pack(mnemonic)) {
+        JUMP_TABLE(MNEMONIC_CASE)
+        default: return -1;
+    }
+}
\ No newline at end of file
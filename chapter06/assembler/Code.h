@@ -1,11 +1,26 @@
 #ifndef CODE_H_
 #define CODE_H_
 
-int create_mnemonic_tables();
-void free_mnemonic_tables();
+#include "Utils.h"
 
-int code_dest(unsigned char *mnemonic);
-int code_comp(unsigned char *mnemonic);
-int code_jump(unsigned char *mnemonic);
+// Mnemonic and the bits it translates to
+typedef struct {
+    const char *mnemonic;
+    int bits;
+} Mnemonic;
+
+// Bit maps of the Hack C-instruction fields, indexed by position (not by bits)
+extern const Mnemonic dest_mnemonics[];
+extern const Mnemonic comp_mnemonics[];
+extern const Mnemonic jump_mnemonics[];
+extern const size_t dest_mnemonics_count;
+extern const size_t comp_mnemonics_count;
+extern const size_t jump_mnemonics_count;
+
+// Translate a field of a C-instruction into its bits, without any allocation.
+// An empty dest/jump is the "null" mnemonic. They return -1 on an invalid mnemonic.
+int code_dest(String_View mnemonic);
+int code_comp(String_View mnemonic);
+int code_jump(String_View mnemonic);
 
 #endif // CODE_H_
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "Disassembler.h"
+#include "Code.h"
+
+static void set_entry(Disasm_Entry *e, const char *text) {
+    size_t len = strlen(text);
+    assert(len < sizeof(e->text));
+    memcpy(e->text, text, len + 1);
+    e->len = (uint8_t)len;
+}
+
+Disasm_Table *create_disasm_table(void) {
+    Disasm_Table *lut = malloc(sizeof(Disasm_Table));
+    if (!lut) return NULL;
+
+    for (int word = 0; word < 0x8000; ++word) {
+        char text[8];
+        snprintf(text, sizeof(text), "@%d", word);
+        set_entry(&lut->words[word], text);
+    }
+
+    // comp (with its a-bit) indexed by its 7 bits; the CPU ignores bits 14 and 13
+    const char *comps[128] = {0};
+    for (size_t i = 0; i < comp_mnemonics_count; ++i) {
+        comps[comp_mnemonics[i].bits] = comp_mnemonics[i].mnemonic;
+    }
+    for (int word = 0x8000; word < 0x10000; ++word) {
+        const char *comp = comps[(word >> 6) & 0x7F];
+        if (!comp) {
+            char text[16];
+            snprintf(text, sizeof(text), "// 0x%04X", word);
+            set_entry(&lut->words[word], text);
+            continue;
+        }
+        const char *dest = dest_mnemonics[(word >> 3) & 0x7].mnemonic;
+        const char *jump = jump_mnemonics[word & 0x7].mnemonic;
+        char text[16];
+        snprintf(text, sizeof(text), "%s%s%s%s%s", dest, *dest ? "=" : "", comp, *jump ? ";" : "", jump);
+        set_entry(&lut->words[word], text);
+    }
+    return lut;
+}
+
+void free_disasm_table(Disasm_Table *lut) {
+    free(lut);
+}
+
+// Name of the symbol of the kind at address, or NULL (symbols of a kind are sorted by address)
+static const Hack_Symbol *find_symbol(const Hack_Symbol *symbols, size_t count, Symbol_Kind kind, uint16_t address) {
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const Hack_Symbol *s = &symbols[mid];
+        if (s->kind < kind || (s->kind == kind && s->address < address)) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < count && symbols[lo].kind == kind && symbols[lo].address == address) return &symbols[lo];
+    return NULL;
+}
+
+void disassemble(const Disasm_Table *lut, const uint16_t *rom, size_t count,
+                 const Hack_Symbol *symbols, size_t symbol_count, String_Builder *out) {
+    // worst case per word: a 15 char line, plus its labels
+    da_reserve(out, out->count + count * 16);
+
+    // labels sorted by address: walked along with the ROM
+    size_t next_label = 0;
+    while (next_label < symbol_count && symbols[next_label].kind != SYMBOL_LABEL) next_label++;
+
+    for (size_t pc = 0; pc <= count; ++pc) {
+        // labels at pc, including the ones that end the program
+        for (; next_label < symbol_count && symbols[next_label].kind == SYMBOL_LABEL &&
+               symbols[next_label].address <= pc; ++next_label) {
+            const Hack_Symbol *s = &symbols[next_label];
+            if (s->address < pc) continue;
+            da_append(out, '(');
+            sb_append_buf(out, s->name, strlen(s->name));
+            sb_append_buf(out, ")\n", 2);
+        }
+        if (pc == count) break;
+
+        uint16_t word = rom[pc];
+        const Hack_Symbol *label = NULL, *variable = NULL;
+        if (symbol_count > 0 && word < 0x8000 && pc + 1 < count && rom[pc + 1] >= 0x8000) {
+            uint16_t next = rom[pc + 1];
+            if (next & 0x7) label = find_symbol(symbols, symbol_count, SYMBOL_LABEL, word);
+            else if ((next & 0x1000) || (next & 0x8)) variable = find_symbol(symbols, symbol_count, SYMBOL_VARIABLE, word);
+        }
+
+        if (label) {
+            da_append(out, '@');
+            sb_append_buf(out, label->name, strlen(label->name));
+        } else {
+            const Disasm_Entry *e = &lut->words[word];
+            sb_append_buf(out, e->text, e->len);
+        }
+        // variables stay numeric: reassembling allocates them by first use, which may differ
+        if (variable) {
+            sb_append_buf(out, " // ", 4);
+            sb_append_buf(out, variable->name, strlen(variable->name));
+        }
+        da_append(out, '\n');
+    }
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static bool ends_with_ext(const char *path, const char *ext) {
+    size_t n = strlen(path), m = strlen(ext);
+    return n >= m && strcmp(path + n - m, ext) == 0;
+}
+
+int read_rom(const char *path, Rom *rom) {
+    Mapped_File f;
+    if (!map_file(path, &f)) {
+        perror("Error opening file (input)");
+        return -1;
+    }
+
+    int result = 0;
+    rom->count = 0;
+    if (ends_with_ext(path, ".bin")) {
+        size_t n = f.count / 2;
+        da_reserve(rom, n);
+        const unsigned char *p = (const unsigned char *)f.data;
+        for (size_t i = 0; i < n; ++i) rom->items[i] = (uint16_t)(p[2*i] | p[2*i + 1] << 8);
+        rom->count = n;
+    } else {
+        bool hex = ends_with_ext(path, ".hex");
+        da_reserve(rom, f.count / (hex ? 5 : 17) + 1);
+        String_View source = mf_to_sv(f);
+        while (source.count > 0 && result == 0) {
+            String_View line = sv_trim(sv_chop_by_delim(&source, '\n'));
+            if (line.count == 0) continue;
+            uint32_t word = 0;
+            for (size_t i = 0; i < line.count; ++i) {
+                int digit = hex ? hex_digit(line.data[i]) : line.data[i] == '1' ? 1 : line.data[i] == '0' ? 0 : -1;
+                if (digit < 0 || line.count != (hex ? 4u : 16u)) {
+                    fprintf(stderr, "Invalid word in %s: "SV_Fmt"\n", path, SV_Arg(line));
+                    result = -1;
+                    break;
+                }
+                word = word << (hex ? 4 : 1) | (uint32_t)digit;
+            }
+            da_append(rom, (uint16_t)word);
+        }
+    }
+
+    unmap_file(&f);
+    return result;
+}
+
+int read_symbol_map(const char *path, Hack_Symbol **symbols, size_t *count, Arena *names) {
+    Mapped_File f;
+    if (!map_file(path, &f)) return -1;
+
+    struct { Hack_Symbol *items; size_t count; size_t capacity; } list = {0};
+    String_View source = mf_to_sv(f);
+    while (source.count > 0) {
+        String_View line = sv_trim(sv_chop_by_delim(&source, '\n'));
+        // "<L|V> <4 hex digits> <name>"
+        if (line.count < 8 || (line.data[0] != 'L' && line.data[0] != 'V') || line.data[1] != ' ' || line.data[6] != ' ') continue;
+        int address = 0;
+        bool valid = true;
+        for (int i = 2; i < 6 && valid; ++i) {
+            int digit = hex_digit(line.data[i]);
+            if (digit < 0) valid = false;
+            else address = address << 4 | digit;
+        }
+        if (!valid) continue;
+
+        char *name = arena_alloc(names, line.count - 7 + 1);
+        memcpy(name, line.data + 7, line.count - 7);
+        name[line.count - 7] = '\0';
+        Hack_Symbol s = {name, (uint16_t)address, line.data[0] == 'L' ? SYMBOL_LABEL : SYMBOL_VARIABLE};
+        da_append(&list, s);
+    }
+    unmap_file(&f);
+
+    *symbols = list.items;
+    *count = list.count;
+    return 0;
+}
+
+int disassembler(const char *path) {
+    Rom rom = {0};
+    if (read_rom(path, &rom) < 0) { da_free(rom); return -1; }
+
+    char *sym_path = replace_extension(path, ".sym");
+    char *out_path = replace_extension(path, ".dis.asm");
+
+    Hack_Symbol *symbols = NULL;
+    size_t symbol_count = 0;
+    Arena names = {0};
+    FILE *sym_file = fopen(sym_path, "rb"); // the map is optional
+    if (sym_file) {
+        fclose(sym_file);
+        read_symbol_map(sym_path, &symbols, &symbol_count, &names);
+    }
+
+    int result = 0;
+    Disasm_Table *lut = create_disasm_table();
+    String_Builder text = {0};
+    if (!lut) {
+        perror("Error creating the disassembly table");
+        result = -1;
+    } else {
+        disassemble(lut, rom.items, rom.count, symbols, symbol_count, &text);
+
+        // an invalid comp has no mnemonic: its comment line takes no ROM word when reassembled
+        size_t invalid = 0;
+        for (size_t i = 0; i < rom.count; ++i) invalid += lut->words[rom.items[i]].text[0] == '/';
+        if (invalid > 0) {
+            fprintf(stderr, "Warning: %zu word(s) with an invalid comp written as comments, "
+                            "%s does not reassemble to the same ROM\n", invalid, out_path);
+        }
+
+        Writer out;
+        if (!writer_open(&out, out_path, false)) {
+            perror("Error opening file (output)");
+            result = -1;
+        } else {
+            writer_write(&out, text.items, text.count);
+            if (!writer_close(&out)) { perror("Error writing file (output)"); result = -1; }
+        }
+    }
+
+    sb_free(text);
+    free_disasm_table(lut);
+    free(symbols);
+    arena_free(&names);
+    free(sym_path);
+    free(out_path);
+    da_free(rom);
+    return result;
+}
@@ -0,0 +1,38 @@
+#ifndef DISASSEMBLER_H_
+#define DISASSEMBLER_H_
+
+#include "Assembler.h"
+
+// Text of every possible 16-bit word, so decoding is one table read and one copy per word
+typedef struct {
+    char text[15];      // "AMD=D|M;JMP", "@32767" or a "//" comment for invalid comps
+    uint8_t len;
+} Disasm_Entry;
+
+typedef struct {
+    Disasm_Entry words[1 << 16];
+} Disasm_Table;
+
+// Built once from the comp/dest/jump bit maps of Code.c. Read-only afterwards: can be shared.
+Disasm_Table *create_disasm_table(void);
+void free_disasm_table(Disasm_Table *lut);
+
+// Appends the assembly of rom to out. With symbols (a .sym map, sorted like symbol_map()), the
+// labels are written before their instruction and the A-instruction before a jump loads the name of
+// its target label. The one before an instruction that uses M gets the name of its variable as a
+// comment. A word whose comp is not a valid mnemonic is written as a "// 0xXXXX" comment: the
+// assembler cannot produce it, so such output does not reassemble to the same ROM (the later
+// addresses move down by one).
+void disassemble(const Disasm_Table *lut, const uint16_t *rom, size_t count,
+                 const Hack_Symbol *symbols, size_t symbol_count, String_Builder *out);
+
+// Reads a ROM image written by the assembler: .hack, .bin or .hex, by its extension
+int read_rom(const char *path, Rom *rom);
+
+// Reads a .sym map written by write_symbol_map(). Names are allocated in the arena.
+int read_symbol_map(const char *path, Hack_Symbol **symbols, size_t *count, Arena *names);
+
+// Disassembles a ROM image into <name>.dis.asm, with the names of <name>.sym when it exists
+int disassembler(const char *path);
+
+#endif // DISASSEMBLER_H_
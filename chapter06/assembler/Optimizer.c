@@ -0,0 +1,513 @@
+#include "Optimizer.h"
+#include "Cleaner.h"
+
+static const char *pass_names[OPT_COUNT] = {
+    [OPT_PUSH_POP] = "pushpop",
+    [OPT_JUMPS] = "jumps",
+    [OPT_A_VALUES] = "areg",
+    [OPT_DEAD_CODE] = "dce",
+};
+
+static bool is(const Asm_Line *line, const char *text) {
+    return sv_eq(line->text, sv_from_cstr(text));
+}
+
+static Asm_Line line_of(Asm_Kind kind, const char *text) {
+    return (Asm_Line){kind, sv_from_cstr(text)};
+}
+
+// True when the lines starting at code->items[i] are exactly the given texts
+static bool matches(const Asm_Lines *code, size_t i, const char **texts, size_t n) {
+    if (i + n > code->count) return false;
+    for (size_t k = 0; k < n; ++k) {
+        if (!is(&code->items[i + k], texts[k])) return false;
+    }
+    return true;
+}
+
+// comp part of a C-instruction: between '=' and ';'
+static String_View comp_of(String_View text) {
+    const char *eq = memchr(text.data, '=', text.count);
+    if (eq) text = sv_from_parts(eq + 1, text.count - (size_t)(eq + 1 - text.data));
+    const char *semi = memchr(text.data, ';', text.count);
+    if (semi) text.count = (size_t)(semi - text.data);
+    return text;
+}
+
+// dest part of a C-instruction: before '=', empty without it
+static String_View dest_of(String_View text) {
+    const char *eq = memchr(text.data, '=', text.count);
+    return sv_from_parts(text.data, eq ? (size_t)(eq - text.data) : 0);
+}
+
+static bool reads_m(const Asm_Line *line) {
+    if (line->kind != ASM_C) return false;
+    String_View comp = comp_of(line->text);
+    return memchr(comp.data, 'M', comp.count) != NULL;
+}
+
+void asm_parse(String_View cleaned, Asm_Lines *code) {
+    code->count = 0;
+    while (cleaned.count > 0) {
+        String_View text = sv_chop_by_delim(&cleaned, '\n');
+        Asm_Kind kind = text.data[0] == '@' ? ASM_A : text.data[0] == '(' ? ASM_LABEL : ASM_C;
+        da_append(code, ((Asm_Line){kind, text}));
+    }
+}
+
+void asm_emit(const Asm_Lines *code, String_Builder *out) {
+    da_foreach(Asm_Line, line, code) {
+        sb_append_buf(out, line->text.data, line->text.count);
+        da_append(out, '\n');
+    }
+}
+
+void asm_free(Asm_Lines *code) {
+    da_free(*code);
+    arena_free(&code->text);
+    *code = (Asm_Lines){0};
+}
+
+static size_t rom_words(const Asm_Lines *code) {
+    size_t n = 0;
+    da_foreach(Asm_Line, line, code) n += line->kind != ASM_LABEL;
+    return n;
+}
+
+void opt_push_pop(Asm_Lines *code, Opt_Stats *stats) {
+    static const char *window[] = {"@SP", "A=M", "M=D", "@SP", "M=M+1", "@SP", "AM=M-1", "D=M"};
+    const size_t n = sizeof(window) / sizeof(window[0]);
+
+    size_t w = 0;
+    for (size_t r = 0; r < code->count;) {
+        if (!matches(code, r, window, n)) {
+            code->items[w++] = code->items[r++];
+            continue;
+        }
+
+        r += n;
+        stats->rewrites++;
+        stats->removed += n;
+        const Asm_Line *next = r < code->count ? &code->items[r] : NULL;
+        if (next && next->kind == ASM_A) {
+            // A is reloaded right away: nothing is left of the window
+            continue;
+        }
+        code->items[w++] = line_of(ASM_A, "@SP");
+        if (next && is(next, "A=A-1")) {
+            // binary operator after the push: A = SP-1 directly
+            code->items[w++] = line_of(ASM_C, "A=M-1");
+            stats->removed++;
+            r++;
+            stats->added += 2;
+        } else if (next && reads_m(next)) {
+            // the popped slot is read again: keep it written
+            code->items[w++] = line_of(ASM_C, "A=M");
+            code->items[w++] = line_of(ASM_C, "M=D");
+            stats->added += 3;
+        } else {
+            code->items[w++] = line_of(ASM_C, "A=M");
+            stats->added += 2;
+        }
+    }
+    code->count = w;
+}
+
+static bool writes_a(const Asm_Line *line) {
+    if (line->kind != ASM_C) return false;
+    String_View dest = dest_of(line->text);
+    return memchr(dest.data, 'A', dest.count) != NULL;
+}
+
+// Value of an A-instruction: the address for numbers and predefined symbols, the name otherwise
+typedef struct {
+    bool known;
+    int address;        // -1: not known before the symbols are resolved
+    String_View name;
+} A_Value;
+
+static A_Value a_value(HashTable *predefined, String_View text) {
+    A_Value v = {true, -1, sv_from_parts(text.data + 1, text.count - 1)};
+    if (v.name.count > 0 && isdigit((unsigned char)v.name.data[0])) {
+        int value = 0;
+        for (size_t i = 0; i < v.name.count && isdigit((unsigned char)v.name.data[i]); ++i) {
+            value = (value * 10 + (v.name.data[i] - '0')) & 0xFFFF;
+        }
+        v.address = value & 0x7FFF;
+    } else if (contains_sv(predefined, v.name)) {
+        v.address = get_address_sv(predefined, v.name) & 0x7FFF;
+    }
+    return v;
+}
+
+static bool same_a_value(A_Value a, A_Value b) {
+    if (!a.known || !b.known) return false;
+    if (a.address >= 0 || b.address >= 0) return a.address == b.address;
+    return sv_eq(a.name, b.name);
+}
+
+void opt_a_values(Asm_Lines *code, Opt_Stats *stats) {
+    HashTable *predefined = create_table();
+    assert(predefined != NULL && "More RAM!");
+
+    A_Value a = {0};
+    size_t w = 0;
+    for (size_t r = 0; r < code->count; ++r) {
+        Asm_Line line = code->items[r];
+        if (line.kind == ASM_LABEL) {
+            a.known = false; // reached by jumps from anywhere
+        } else if (line.kind == ASM_A) {
+            A_Value v = a_value(predefined, line.text);
+            if (same_a_value(a, v)) {
+                stats->rewrites++;
+                stats->removed++;
+                continue;
+            }
+            a = v;
+        } else if (writes_a(&line)) {
+            a.known = false;
+        }
+        code->items[w++] = line;
+    }
+    code->count = w;
+
+    free_table(predefined);
+}
+
+static bool is_unconditional_jump(const Asm_Line *line) {
+    if (line->kind != ASM_C) return false;
+    const char *semi = memchr(line->text.data, ';', line->text.count);
+    if (!semi) return false;
+    String_View jump = sv_from_parts(semi + 1, line->text.count - (size_t)(semi + 1 - line->text.data));
+    if (sv_eq(jump, sv_from_cstr("JMP"))) return true;
+    // the comp of D;JMP-like jumps is irrelevant, but 0;JGE and friends always jump too
+    String_View comp = comp_of(line->text);
+    if (sv_eq(comp, sv_from_cstr("0"))) return sv_eq(jump, sv_from_cstr("JEQ")) || sv_eq(jump, sv_from_cstr("JGE")) || sv_eq(jump, sv_from_cstr("JLE"));
+    return false;
+}
+
+typedef struct {
+    size_t *items;
+    size_t count;
+    size_t capacity;
+} Indices;
+
+void opt_dead_code(Asm_Lines *code, Opt_Stats *stats, Rom_Regions *regions, Arena *names) {
+    // region r covers the lines [starts[r], starts[r+1])
+    Indices starts = {0};
+    da_append(&starts, 0);
+    HashTable *labels = create_table();
+    assert(labels != NULL && "More RAM!");
+    for (size_t i = 0; i < code->count; ++i) {
+        if (code->items[i].kind != ASM_LABEL) continue;
+        if (i > 0) da_append(&starts, i);
+        String_View name = sv_from_parts(code->items[i].text.data + 1, code->items[i].text.count - 2);
+        add_symbol_sv(labels, name, (int)starts.count - 1, SYMBOL_LABEL);
+    }
+    size_t n = starts.count;
+    da_append(&starts, code->count);
+
+    bool *reachable = calloc(n, sizeof(bool));
+    assert(reachable != NULL && "More RAM!");
+    Indices work = {0};
+    reachable[0] = true;
+    da_append(&work, 0);
+
+    while (work.count > 0) {
+        size_t r = work.items[--work.count];
+        bool live = true; // false after an unconditional jump: the rest of the region is dead
+        for (size_t i = starts.items[r]; i < starts.items[r + 1] && live; ++i) {
+            const Asm_Line *line = &code->items[i];
+            if (line->kind == ASM_A) {
+                const Entry *e = find_entry_sv(labels, sv_from_parts(line->text.data + 1, line->text.count - 1));
+                if (e && e->kind == SYMBOL_LABEL && !reachable[e->address]) {
+                    reachable[e->address] = true;
+                    da_append(&work, (size_t)e->address);
+                }
+            } else if (is_unconditional_jump(line)) {
+                live = false;
+            }
+        }
+        if (live && r + 1 < n && !reachable[r + 1]) {
+            reachable[r + 1] = true;
+            da_append(&work, r + 1);
+        }
+    }
+
+    size_t w = 0, address = 0;
+    for (size_t r = 0; r < n; ++r) {
+        const Asm_Line *first = &code->items[starts.items[r]];
+        Rom_Region region = {NULL, address, 0, reachable[r]};
+        if (regions && starts.items[r] < code->count && first->kind == ASM_LABEL) {
+            char *label = arena_alloc(names, first->text.count - 1);
+            memcpy(label, first->text.data + 1, first->text.count - 2);
+            label[first->text.count - 2] = '\0';
+            region.label = label;
+        }
+
+        for (size_t i = starts.items[r]; i < starts.items[r + 1]; ++i) {
+            region.words += code->items[i].kind != ASM_LABEL;
+            if (reachable[r]) code->items[w++] = code->items[i];
+        }
+        if (!reachable[r]) {
+            stats->rewrites++;
+            stats->removed += region.words;
+        }
+        if (regions) da_append(regions, region);
+        address += region.words;
+    }
+    code->count = w;
+
+    da_free(work);
+    free(reachable);
+    free_table(labels);
+    da_free(starts);
+}
+
+static bool has_jump(const Asm_Line *line) {
+    return line->kind == ASM_C && memchr(line->text.data, ';', line->text.count) != NULL;
+}
+
+// The jump only depends on the label loaded before it: no dest, and a comp that reads neither A
+// nor M, so the label can be replaced by another one
+static bool retargetable_jump(const Asm_Line *line) {
+    if (!has_jump(line) || dest_of(line->text).count > 0) return false;
+    String_View comp = comp_of(line->text);
+    return !memchr(comp.data, 'A', comp.count) && !memchr(comp.data, 'M', comp.count);
+}
+
+static String_View label_name(const Asm_Line *line) {
+    return sv_from_parts(line->text.data + 1, line->text.count - 2);
+}
+
+// Index of the first instruction at or after line i, skipping labels
+static size_t skip_labels(const Asm_Lines *code, size_t i) {
+    while (i < code->count && code->items[i].kind == ASM_LABEL) i++;
+    return i;
+}
+
+// Final target of a jump to the label: while the label is followed by "@M, 0;JMP", go on to M.
+// Returns the index of the "@M" line to load instead, or -1 when the label is already final.
+static long thread_target(const Asm_Lines *code, HashTable *labels, String_View label) {
+    long target = -1;
+    for (int hops = 0; hops < 64; ++hops) {
+        const Entry *e = find_entry_sv(labels, label);
+        if (!e || e->kind != SYMBOL_LABEL) break;
+        size_t i = skip_labels(code, (size_t)e->address);
+        if (i + 1 >= code->count || code->items[i].kind != ASM_A || !is(&code->items[i + 1], "0;JMP")) break;
+        String_View next = sv_from_parts(code->items[i].text.data + 1, code->items[i].text.count - 1);
+        if (sv_eq(next, label)) break; // (L) @L 0;JMP: the end loop
+        target = (long)i;
+        label = next;
+    }
+    return target;
+}
+
+// The jump with the opposite condition, NULL if there is none
+static const char *inverse_jump(String_View jump) {
+    static const char *pairs[][2] = {
+        {"JGT", "JLE"}, {"JEQ", "JNE"}, {"JGE", "JLT"},
+        {"JLE", "JGT"}, {"JNE", "JEQ"}, {"JLT", "JGE"},
+    };
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); ++i) {
+        if (sv_eq(jump, sv_from_cstr(pairs[i][0]))) return pairs[i][1];
+    }
+    return NULL;
+}
+
+// True when one of the labels right after line i is (L)
+static bool label_follows(const Asm_Lines *code, size_t i, String_View label) {
+    for (; i < code->count && code->items[i].kind == ASM_LABEL; ++i) {
+        if (sv_eq(label_name(&code->items[i]), label)) return true;
+    }
+    return false;
+}
+
+void opt_jumps(Asm_Lines *code, Opt_Stats *stats) {
+    HashTable *labels = create_table();
+    assert(labels != NULL && "More RAM!");
+    for (size_t i = 0; i < code->count; ++i) {
+        if (code->items[i].kind == ASM_LABEL) add_symbol_sv(labels, label_name(&code->items[i]), (int)i, SYMBOL_LABEL);
+    }
+
+    // threading: the lines do not move, so the label indices stay valid
+    for (size_t i = 0; i + 1 < code->count; ++i) {
+        Asm_Line *at = &code->items[i];
+        if (at->kind != ASM_A || !retargetable_jump(&code->items[i + 1])) continue;
+        // after a conditional jump that is not taken, A must not be needed
+        if (!is_unconditional_jump(&code->items[i + 1]) && i + 2 < code->count && code->items[i + 2].kind != ASM_A) continue;
+        long target = thread_target(code, labels, sv_from_parts(at->text.data + 1, at->text.count - 1));
+        if (target < 0) continue;
+        *at = code->items[target];
+        stats->rewrites++;
+    }
+    free_table(labels);
+
+    size_t w = 0;
+    for (size_t r = 0; r < code->count;) {
+        const Asm_Line *at = &code->items[r];
+        const Asm_Line *jump = r + 1 < code->count ? &code->items[r + 1] : NULL;
+        if (at->kind != ASM_A || !jump || !has_jump(jump) || dest_of(jump->text).count > 0) {
+            code->items[w++] = code->items[r++];
+            continue;
+        }
+        String_View label = sv_from_parts(at->text.data + 1, at->text.count - 1);
+
+        // @L, <jump>, (L): falls through either way
+        if (label_follows(code, r + 2, label)) {
+            stats->rewrites++;
+            stats->removed += 2;
+            r += 2;
+            continue;
+        }
+
+        // @L, c;Jxx, @M, 0;JMP, (L)  ->  @M, c;Jinv, (L)
+        const char *semi = memchr(jump->text.data, ';', jump->text.count);
+        String_View cond = sv_from_parts(semi + 1, jump->text.count - (size_t)(semi + 1 - jump->text.data));
+        const char *inverse = inverse_jump(cond);
+        if (inverse && retargetable_jump(jump) && r + 3 < code->count && code->items[r + 2].kind == ASM_A &&
+            is(&code->items[r + 3], "0;JMP") && label_follows(code, r + 4, label)) {
+            String_View comp = comp_of(jump->text);
+            char *text = arena_alloc(&code->text, comp.count + 4);
+            memcpy(text, comp.data, comp.count);
+            text[comp.count] = ';';
+            memcpy(text + comp.count + 1, inverse, 3);
+            code->items[w++] = code->items[r + 2];
+            code->items[w++] = (Asm_Line){ASM_C, sv_from_parts(text, comp.count + 4)};
+            stats->rewrites++;
+            stats->removed += 2;
+            r += 4;
+            continue;
+        }
+
+        code->items[w++] = code->items[r++];
+    }
+    code->count = w;
+}
+
+// @N right before a jump: the program relies on absolute ROM addresses, so no code may move
+static bool has_absolute_jumps(const Asm_Lines *code) {
+    for (size_t i = 0; i + 1 < code->count; ++i) {
+        const Asm_Line *line = &code->items[i];
+        if (line->kind != ASM_A || !isdigit((unsigned char)line->text.data[1])) continue;
+        const Asm_Line *next = &code->items[i + 1];
+        if (next->kind == ASM_C && memchr(next->text.data, ';', next->text.count)) return true;
+    }
+    return false;
+}
+
+typedef void (*Opt_Fn)(Asm_Lines *code, Opt_Stats *stats);
+
+static const Opt_Fn pass_fns[OPT_COUNT] = {
+    [OPT_PUSH_POP] = opt_push_pop,
+    [OPT_JUMPS] = opt_jumps,
+    [OPT_A_VALUES] = opt_a_values,
+    [OPT_DEAD_CODE] = NULL, // needs the regions of the report
+};
+
+unsigned opt_parse_passes(const char *list) {
+    if (strcmp(list, "all") == 0) return OPT_ALL;
+
+    unsigned passes = 0;
+    String_View rest = sv_from_cstr(list);
+    while (rest.count > 0) {
+        String_View name = sv_chop_by_delim(&rest, ',');
+        int found = -1;
+        for (int i = 0; i < OPT_COUNT; ++i) {
+            if (sv_eq(name, sv_from_cstr(pass_names[i]))) found = i;
+        }
+        if (found < 0) return 0;
+        passes |= 1u << found;
+    }
+    return passes;
+}
+
+void optimize_source(String_View source, unsigned passes, String_Builder *out, Opt_Report *report) {
+    String_Builder clean = {0};
+    Asm_Lines code = {0};
+    asm_parse(clean_source(source, &clean), &code);
+
+    *report = (Opt_Report){0};
+    report->words_before = rom_words(&code);
+    report->absolute = has_absolute_jumps(&code);
+    for (int i = 0; i < OPT_COUNT && !report->absolute; ++i) {
+        if (!(passes & (1u << i))) continue;
+        if (i == OPT_DEAD_CODE) opt_dead_code(&code, &report->passes[i], &report->regions, &report->names);
+        else pass_fns[i](&code, &report->passes[i]);
+    }
+    report->words_after = rom_words(&code);
+
+    out->count = 0;
+    asm_emit(&code, out);
+
+    asm_free(&code);
+    sb_free(clean);
+}
+
+void opt_print_report(const char *path, const Opt_Report *report) {
+    printf("%s: %zu -> %zu ROM words\n", path, report->words_before, report->words_after);
+    if (report->absolute) printf("    jumps to absolute ROM addresses: left as it is\n");
+    for (int i = 0; i < OPT_COUNT; ++i) {
+        const Opt_Stats *st = &report->passes[i];
+        if (st->rewrites == 0) continue;
+        printf("    %-10s %6zu rewrites, %6zu instructions removed, %6zu ROM words saved\n",
+               pass_names[i], st->rewrites, st->removed, st->removed - st->added);
+    }
+    size_t saved = report->words_before - report->words_after;
+    printf("    %-10s %6zu ROM words saved (%.1f%%)\n", "total", saved,
+           report->words_before ? 100.0 * saved / report->words_before : 0.0);
+
+    if (report->regions.count == 0) return;
+    size_t kept = 0;
+    da_foreach(Rom_Region, region, &report->regions) kept += region->reachable ? region->words : 0;
+    printf("ROM budget: %zu of %d words in reachable regions (%.1f%%)\n", kept, HACK_ROM_SIZE,
+           100.0 * kept / HACK_ROM_SIZE);
+    printf("    %7s %6s  %-9s %s\n", "address", "words", "", "region");
+    da_foreach(Rom_Region, region, &report->regions) {
+        printf("    %7zu %6zu  %-9s %s\n", region->address, region->words,
+               region->reachable ? "kept" : "DROPPED", region->label ? region->label : "(start)");
+    }
+}
+
+void opt_report_free(Opt_Report *report) {
+    da_free(report->regions);
+    arena_free(&report->names);
+    report->regions = (Rom_Regions){0};
+}
+
+int assembler_optimized(HashTable *t, const char *path, Output_Format format, unsigned passes, bool emit) {
+    Mapped_File f;
+    if (!map_file(path, &f)) {
+        perror("Error opening file (input)");
+        return -1;
+    }
+
+    String_Builder optimized = {0};
+    Opt_Report report;
+    optimize_source(mf_to_sv(f), passes, &optimized, &report);
+    unmap_file(&f);
+    opt_print_report(path, &report);
+    opt_report_free(&report);
+
+    int result = 0;
+    if (emit) {
+        char *opt_filename = output_name(path, ".opt.asm");
+        Writer out;
+        if (!opt_filename || !writer_open(&out, opt_filename, false)) {
+            perror("Error opening file (optimized assembly)");
+            result = -1;
+        } else {
+            writer_write(&out, optimized.items, optimized.count);
+            if (!writer_close(&out)) { perror("Error writing file (optimized assembly)"); result = -1; }
+        }
+        free(opt_filename);
+    }
+
+    Rom rom = {0};
+    if (result == 0) result = assemble_source(t, sb_to_sv(optimized), &rom);
+    if (result == 0) result = write_rom(&rom, path, format);
+
+    da_free(rom);
+    sb_free(optimized);
+    return result;
+}
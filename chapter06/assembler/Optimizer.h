@@ -0,0 +1,112 @@
+#ifndef OPTIMIZER_H_
+#define OPTIMIZER_H_
+
+#include "Parser.h"
+
+// Optimizer for the Hack assembly produced by the VM translators. It works on the cleaned
+// source (see clean_source()) as an array of lines; the passes rewrite the array in place.
+
+typedef enum {
+    ASM_A,      // @value
+    ASM_C,      // dest=comp;jump
+    ASM_LABEL   // (LABEL)
+} Asm_Kind;
+
+typedef struct {
+    Asm_Kind kind;
+    String_View text;   // the whole line, e.g. "@SP", "AM=M-1", "(LOOP)"
+} Asm_Line;
+
+typedef struct {
+    Asm_Line *items;
+    size_t count;
+    size_t capacity;
+    Arena text;         // lines written by the passes
+} Asm_Lines;
+
+// Passes run in this order
+typedef enum {
+    OPT_PUSH_POP,   // push immediately followed by a pop: D already holds the value
+    OPT_JUMPS,      // jumps to jumps and jumps to the next instruction
+    OPT_A_VALUES,   // @X when A already holds X
+    OPT_DEAD_CODE,  // label regions that cannot be reached from address 0
+    OPT_COUNT
+} Opt_Pass;
+
+#define OPT_ALL ((1u << OPT_COUNT) - 1)
+
+typedef struct {
+    size_t rewrites;    // windows rewritten
+    size_t removed;     // instructions deleted
+    size_t added;       // instructions inserted in their place
+} Opt_Stats;
+
+#define HACK_ROM_SIZE 32768
+
+// Code from a label (or from address 0) up to the next label
+typedef struct {
+    const char *label;  // NULL for the code before the first label
+    size_t address;     // before the dead code is stripped
+    size_t words;
+    bool reachable;
+} Rom_Region;
+
+typedef struct {
+    Rom_Region *items;
+    size_t count;
+    size_t capacity;
+} Rom_Regions;
+
+typedef struct {
+    size_t words_before;
+    size_t words_after;
+    bool absolute;          // the source jumps to numeric addresses: not optimized
+    Opt_Stats passes[OPT_COUNT];
+    Rom_Regions regions;    // filled by the dead code pass
+    Arena names;
+} Opt_Report;
+
+void asm_parse(String_View cleaned, Asm_Lines *code);
+void asm_emit(const Asm_Lines *code, String_Builder *out);
+void asm_free(Asm_Lines *code);
+
+// Stack traffic of a push whose value is popped right away:
+//     @SP, A=M, M=D, @SP, M=M+1, @SP, AM=M-1, D=M
+// D and SP end as they started, so the window becomes "@SP, A=M" (A = SP), or nothing when the
+// next instruction loads A. Like the VM, it assumes that RAM above SP is never read.
+void opt_push_pop(Asm_Lines *code, Opt_Stats *stats);
+
+// Jump threading: "@L, <jump>" where (L) is followed by "@M, 0;JMP" jumps to M directly (chains are
+// followed). Then a jump to the next instruction is removed, and a conditional jump over an
+// unconditional one is inverted: "@L, D;JEQ, @M, 0;JMP, (L)" becomes "@M, D;JNE, (L)".
+// Only jumps with no dest and a comp that reads neither A nor M are retargeted.
+// Like the VM translators, it assumes that the code after a label never relies on the value of A.
+void opt_jumps(Asm_Lines *code, Opt_Stats *stats);
+
+// Tracks the value loaded in A along each basic block and drops the @X that would load the value
+// A already holds. A block starts at a label, where A is unknown; a jump does not change A, so its
+// fall-through keeps the value. Any C-instruction with A in its dest (A=M, AM=M-1, ...) clobbers it.
+// Numbers and predefined symbols compare by address (@0 and @SP load the same value).
+void opt_a_values(Asm_Lines *code, Opt_Stats *stats);
+
+// Builds the control flow graph of the label regions and removes the regions that cannot be reached
+// from address 0. A reachable region leads to the next one unless it ends in an unconditional jump,
+// and to every label it loads in A: a direct jump target, or an address stored for a later indirect
+// jump, like the return addresses pushed by call. With regions, the budget of every region is
+// recorded (label names are copied into names).
+void opt_dead_code(Asm_Lines *code, Opt_Stats *stats, Rom_Regions *regions, Arena *names);
+
+// Comma separated pass names ("pushpop", "jumps", "areg", "dce") or "all" into a mask of passes. Returns 0 on unknown names.
+unsigned opt_parse_passes(const char *list);
+
+// Runs the passes of the mask over a source and writes the optimized assembly to out. Sources that
+// jump to numeric ROM addresses (@133, 0;JMP) are copied unchanged: moving any code would break them.
+void optimize_source(String_View source, unsigned passes, String_Builder *out, Opt_Report *report);
+void opt_print_report(const char *path, const Opt_Report *report);
+void opt_report_free(Opt_Report *report);
+
+// Optimizes the .asm file, then assembles it in memory. With emit, the optimized assembly is
+// written next to it as .opt.asm.
+int assembler_optimized(HashTable *t, const char *path, Output_Format format, unsigned passes, bool emit);
+
+#endif // OPTIMIZER_H_
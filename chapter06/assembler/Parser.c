@@ -1,10 +1,6 @@
-#include <stdio.h>
-#include <ctype.h>
-#include <string.h>
-#include <stdlib.h>
-
 #include "Parser.h"
 #include "Code.h"
+#include "Cleaner.h"
 
 typedef enum {
     A_COMMAND,
@@ -12,8 +8,20 @@ typedef enum {
     L_COMMAND
 } CommandType;
 
-static CommandType command_type(char *line) {
-    switch (line[0]) {
+// A-instruction whose symbol was still unknown when it was emitted
+typedef struct {
+    size_t rom_index;
+    String_View sym;
+} Fixup;
+
+typedef struct {
+    Fixup *items;
+    size_t count;
+    size_t capacity;
+} Fixups;
+
+static CommandType command_type(String_View line) {
+    switch (line.data[0]) {
         case '@':
             return A_COMMAND;
         case '(':
@@ -23,141 +31,48 @@ static CommandType command_type(char *line) {
     }
 }
 
-static void remove_whitespace(char *str) {
-    char *src = str;
-    char *dst = str;
-    while(*src != '\0') {
-        if (!isspace((unsigned char)*src))
-            *dst++ = *src;
-        src++;
-    }
-    *dst = '\0';
+// Next line of a source cleaned by clean_source(): never empty. Returns false at the end of the source.
+static bool next_line(String_View *source, String_View *line) {
+    if (source->count == 0) return false;
+    *line = sv_chop_by_delim(source, '\n');
+    return true;
 }
 
-static void remove_comment(char *str) {
-    char *p = strstr(str, "//");
-    if (p) *p = '\0';
-}
-
-static char* symbol(const char *command) {
-    const char *start = command;
-    start++;
-    
-    if (isdigit((unsigned char)*start)) {
-        return (char *)start;
-    }
-
-    const char *end = command + strlen(command);
-    if (*(end-1) == ')') end--;
-
-    size_t len = end - start;
-    char *sy = malloc(len + 1);
-    if (!sy) return NULL;
-
-    strncpy(sy, start, len);
-    sy[len] = '\0';
+static String_View symbol(String_View command) {
+    String_View sy = sv_from_parts(command.data + 1, command.count - 1);
+    if (sy.count > 0 && sy.data[sy.count - 1] == ')') sy.count--;
     return sy;
 }
 
-static char* parser_dest(const char *command) {
-    int a = 0, d = 0, m = 0;
-    const char *p = command;
-
-    while (*p != '\0' && *p != '=') {
-        if (*p == 'A') a = 1;
-        else if (*p == 'D') d = 1;
-        else if (*p == 'M') m = 1;
-        p++;
-    }
-
-    const char *dests[8] = {
-        "Error", "M", "D", "MD", "A", "AM", "AD", "AMD"
-    };
-    const char *chosen = (*p == '\0') ? "NULL" : dests[(a << 2) | (d << 1) | m];
-
-    char *result = malloc(strlen(chosen) + 1);
-    if (!result) return NULL;
-    strcpy(result, chosen);
-    return result;
+static int is_number(String_View sy) {
+    return sy.count > 0 && isdigit((unsigned char)sy.data[0]);
 }
 
-static char* parser_comp(const char *command) {
-    static const char *comps[] = {
-        "0", "1", "-1", "D", "A", "!D", "!A",
-        "-D", "-A", "D+1", "A+1", "D-1", "A-1",
-        "D+A", "D-A", "A-D", "D&A", "D|A", "M",
-        "!M", "-M", "M+1", "M-1", "D+M", "D-M",
-        "M-D", "D&M", "D|M"
-    };
-    const size_t num_comps = sizeof(comps) / sizeof(comps[0]);
-
-    const char *start = strchr(command, '=');
-    if (start) start++;
-    else start = command;
-
-    const char *end = strchr(start, ';');
-    size_t len = end ? (size_t)(end - start) : strlen(start);
-
-    char *cm = malloc(len + 1);
-    if (!cm) return NULL;
-    strncpy(cm, start, len);
-    cm[len] = '\0';
-
-    for (size_t i = 0; i < num_comps; i++) {
-        if (strcmp(cm, comps[i]) == 0) {
-            return cm;
-        }
+static int number(String_View sy) {
+    int value = 0;
+    for (size_t i = 0; i < sy.count && isdigit((unsigned char)sy.data[i]); ++i) {
+        value = value * 10 + (sy.data[i] - '0');
+        value &= 0xFFFF;
     }
-
-    free(cm);
-    cm = malloc(strlen("Error") + 1);
-    if (!cm) return NULL;
-    strcpy(cm, "Error");
-    return cm;
+    return value;
 }
 
-static char* parser_jump(const char *command) {
-    static const char *jumps[] = {
-        "JGT", "JEQ", "JGE", "JLT", "JNE", "JLE", "JMP"
-    };
-    const size_t num_jumps = sizeof(jumps) / sizeof(jumps[0]);
-
-    const char *p = strchr(command, ';');
-    if (!p) {
-        char *null_str = malloc(strlen("NULL") + 1);
-        if (!null_str) return NULL;
-        strcpy(null_str, "NULL");
-        return null_str;
-    }
-    p++;
-
-    for (size_t i = 0; i < num_jumps; i++) {
-        if (strcmp(p, jumps[i]) == 0) {
-            char *jmp = malloc(strlen(jumps[i]) + 1);
-            if (!jmp) return NULL;
-            strcpy(jmp, jumps[i]);
-            return jmp;
-        }
-    }
-
-    char *err = malloc(strlen("Error") + 1);
-    if (!err) return NULL;
-    strcpy(err, "Error");
-    return err;
-}
+static const char *output_extensions[] = {
+    [OUTPUT_HACK] = ".hack",
+    [OUTPUT_BIN]  = ".bin",
+    [OUTPUT_HEX]  = ".hex",
+};
 
-static char* output_name(const char *input_filename) {
+char* output_name(const char *input_filename, const char *ext) {
     size_t len = strlen(input_filename);
     if (len < 4 || strcmp(input_filename + len - 4, ".asm") != 0)
         return NULL;
-    
-    char *output_filename = malloc(len + 1);
-    if (!output_filename) return NULL;
 
-    strncpy(output_filename, input_filename, len - 4);
-    output_filename[len - 4] = '\0';
+    char *output_filename = malloc(len - 4 + strlen(ext) + 1);
+    if (!output_filename) return NULL;
 
-    strcat(output_filename, ".hack");
+    memcpy(output_filename, input_filename, len - 4);
+    strcpy(output_filename + len - 4, ext);
 
     return output_filename;
 }
@@ -169,125 +84,431 @@ static void int_to_binary16_string(int value, char *buffer) {
     buffer[16] = '\0';
 }
 
-int assembler(HashTable *t, const char *path) {
-    FILE *f = fopen(path, "r");
-    if (f == NULL) {
-        perror("Error opening file (input)");
+static int open_output(Writer *w, const char *path, Output_Format format) {
+    char *out_filename = output_name(path, output_extensions[format]);
+    if (!out_filename) { perror("Invalid filename."); return -1; }
+
+    if (!writer_open(w, out_filename, format == OUTPUT_BIN)) {
+        perror("Error opening file (output)");
+        free(out_filename);
         return -1;
     }
+    free(out_filename);
+    return 0;
+}
 
-    char *out_filename = output_name(path);
-    if (!out_filename) { perror("Invalid filename."); return -1; }
+static void write_word(Writer *w, Output_Format format, uint16_t word) {
+    static const char hex_digits[] = "0123456789ABCDEF";
+    switch (format) {
+        case OUTPUT_HACK: {
+            char binary_str[17]; // 16 bits + '\n'
+            int_to_binary16_string(word, binary_str);
+            binary_str[16] = '\n';
+            writer_write(w, binary_str, sizeof(binary_str));
+        } break;
+        case OUTPUT_BIN: {
+            unsigned char bytes[2] = { word & 0xFF, word >> 8 };
+            writer_write(w, bytes, sizeof(bytes));
+        } break;
+        case OUTPUT_HEX: {
+            char hex_str[5] = {
+                hex_digits[(word >> 12) & 0xF], hex_digits[(word >> 8) & 0xF],
+                hex_digits[(word >> 4) & 0xF],  hex_digits[word & 0xF], '\n'
+            };
+            writer_write(w, hex_str, sizeof(hex_str));
+        } break;
+    }
+}
 
-    FILE *out = fopen(out_filename, "w");
-    if (!out) { perror("Error opening file (output)"); return -1; }
-    free(out_filename);
+// Translates a C-instruction (dest=comp;jump) into its 16-bit code. Returns -1 on error.
+static int code_c_command(String_View line) {
+    String_View dest = {0};
+    String_View rest = line;
+    const char *eq = memchr(line.data, '=', line.count);
+    if (eq) {
+        dest = sv_chop_by_delim(&rest, '=');
+        if (dest.count == 0) {
+            fprintf(stderr, "Error in c-instruction formation (dest).");
+            return -1;
+        }
+    }
+    const char *semi = memchr(rest.data, ';', rest.count);
+    String_View comp = sv_chop_by_delim(&rest, ';');
+    String_View jump = rest;
+    if (semi && jump.count == 0) {
+        fprintf(stderr, "Error in c-instruction formation (jump).");
+        return -1;
+    }
+
+    int comp_bits, dest_bits, jump_bits;
+
+    comp_bits = code_comp(comp);
+    if (comp_bits < 0) {
+        fprintf(stderr, "Error in c-instruction formation (comp).");
+        return -1;
+    }
+    dest_bits = code_dest(dest);
+    if (dest_bits < 0) {
+        fprintf(stderr, "Error in c-instruction formation (dest).");
+        return -1;
+    }
+    jump_bits = code_jump(jump);
+    if (jump_bits < 0) {
+        fprintf(stderr, "Error in c-instruction formation (jump).");
+        return -1;
+    }
+
+    return (0b111 << 13) | (comp_bits << 6) | (dest_bits << 3) | jump_bits;
+}
 
-    char line[256];
-    while(fgets(line, sizeof(line), f) != NULL) {
-        remove_whitespace(line);
-        remove_comment(line);
-        if (line[0] == '\0') continue;
+// Pass 2 over a cleaned source: encodes every instruction into out
+static int encode_source(HashTable *t, String_View source, Writer *out, Output_Format format) {
+    String_View line;
+    while (next_line(&source, &line)) {
         CommandType ct = command_type(line);
         int instruction; // binary
-        char binary_str[17]; // 16 bits + '\0'
         if (ct == A_COMMAND) {
             int addr;
-            char *sym = symbol(line);
+            String_View sym = symbol(line);
             // if symbol is not a number
-            if (!isdigit((unsigned char)sym[0])) {
+            if (!is_number(sym)) {
                 // if symbol is in table
-                if (contains(t, sym)) {
-                    addr = get_address(t, sym);
+                if (contains_sv(t, sym)) {
+                    addr = get_address_sv(t, sym);
                     instruction = addr & 0x7FFF; // mask: 0x7FFF = 0111 1111 1111 1111
                 } else {
                     // if symbol is not in table
-                    add_entry(t, sym, t->ram);
+                    add_symbol_sv(t, sym, t->ram, SYMBOL_VARIABLE);
                     instruction = t->ram & 0x7FFF;
                     t->ram++;   
                 }
-                free(sym);
             } else {
-                addr = atoi(sym);
+                addr = number(sym);
                 instruction = addr & 0x7FFF;
             }
 
-            int_to_binary16_string(instruction, binary_str);
-            fprintf(out, "%s\n", binary_str);
+            write_word(out, format, instruction);
 
         } else if (ct == C_COMMAND) {
-            char *mnemonic_comp = parser_comp(line);
-            char *mnemonic_dest = parser_dest(line);
-            char *mnemonic_jump = parser_jump(line);
-            if (!mnemonic_comp || !mnemonic_dest || !mnemonic_jump) { 
-                perror("Error allocating (mnemonic_comp, mnemonic_dest, mnemonic_jump)");
-                return -1;
-            }
+            instruction = code_c_command(line);
+            if (instruction < 0) return -1;
 
-            if (strcmp(mnemonic_comp, "Error") == 0) {
-                fprintf(stderr, "Error in c-instruction formation (comp).");
-                return -1;
-            }
-            if (strcmp(mnemonic_dest, "Error") == 0) {
-                fprintf(stderr, "Error in c-instruction formation (dest).");
-                return -1;
-            }
-            if (strcmp(mnemonic_jump, "Error") == 0) {
-                fprintf(stderr, "Error in c-instruction formation (jump).");
-                return -1;
-            }
+            write_word(out, format, instruction);
+        }
+    }
+    return 0;
+}
 
-            int comp_bits, dest_bits, jump_bits;
+// Pass 1 over a cleaned source: labels get the address of the next instruction
+static void collect_labels(HashTable *t, String_View source) {
+    String_View line;
+    while (next_line(&source, &line)) {
+        CommandType ct = command_type(line);
+        if (ct == A_COMMAND || ct == C_COMMAND) t->rom++;
+        if (ct == L_COMMAND) add_symbol_sv(t, symbol(line), t->rom, SYMBOL_LABEL);
+    }
+}
 
-            comp_bits = code_comp(mnemonic_comp);
-            if (comp_bits < 0) {
-                fprintf(stderr, "Error in Translating Hack assembly language mnemonics into binary codes (comp).");
-                return -1;
-            }
-            dest_bits = code_dest(mnemonic_dest);
-            if (dest_bits < 0) {
-                fprintf(stderr, "Error in Translating Hack assembly language mnemonics into binary codes (dest).");
-                return -1;
-            }
-            jump_bits = code_jump(mnemonic_jump);
-            if (jump_bits < 0) {
-                fprintf(stderr, "Error in Translating Hack assembly language mnemonics into binary codes (jump).");
-                return -1;
-            }
+int assembler(HashTable *t, const char *path, Output_Format format) {
+    Mapped_File f;
+    if (!map_file(path, &f)) {
+        perror("Error opening file (input)");
+        return -1;
+    }
+
+    Writer out;
+    if (open_output(&out, path, format) < 0) { unmap_file(&f); return -1; }
+
+    String_Builder clean = {0};
+    int result = encode_source(t, clean_source(mf_to_sv(f), &clean), &out, format);
+
+    sb_free(clean);
+    unmap_file(&f);
+    if (!writer_close(&out)) { perror("Error writing file (output)"); result = -1; }
+    return result;
+}
+
+int write_rom(const Rom *rom, const char *path, Output_Format format) {
+    Writer out;
+    if (open_output(&out, path, format) < 0) return -1;
 
-            instruction = (0b111 << 13) | (comp_bits << 6) | (dest_bits << 3) | jump_bits;
+    da_foreach(uint16_t, word, rom) write_word(&out, format, *word);
 
-            int_to_binary16_string(instruction, binary_str);
-            fprintf(out, "%s\n", binary_str);
-            
-            free(mnemonic_comp);
-            free(mnemonic_dest);
-            free(mnemonic_jump);
+    if (!writer_close(&out)) { perror("Error writing file (output)"); return -1; }
+    return 0;
+}
+
+// Backpatch in order of appearance so that variables get the same RAM addresses as in the two-pass mode
+static void backpatch(HashTable *t, Rom *rom, const Fixups *fixups) {
+    da_foreach(Fixup, fx, fixups) {
+        if (!contains_sv(t, fx->sym)) {
+            add_symbol_sv(t, fx->sym, t->ram, SYMBOL_VARIABLE);
+            t->ram++;
         }
+        rom->items[fx->rom_index] = get_address_sv(t, fx->sym) & 0x7FFF;
     }
+}
 
-    fclose(f);
-    fclose(out);
-    return 0;
+int assemble_source(HashTable *t, String_View source, Rom *rom) {
+    int result = 0;
+    Fixups fixups = {0};
+    String_Builder clean = {0};
+    source = clean_source(source, &clean);
+    String_View line;
+    while (next_line(&source, &line)) {
+        CommandType ct = command_type(line);
+        if (ct == L_COMMAND) {
+            add_symbol_sv(t, symbol(line), rom->count, SYMBOL_LABEL);
+        } else if (ct == A_COMMAND) {
+            String_View sym = symbol(line);
+            if (is_number(sym)) {
+                da_append(rom, number(sym) & 0x7FFF);
+            } else if (contains_sv(t, sym)) {
+                // predefined symbol or label already seen
+                da_append(rom, get_address_sv(t, sym) & 0x7FFF);
+            } else {
+                // forward label reference or variable: decided once the whole file is read
+                Fixup fx = {rom->count, sym};
+                da_append(&fixups, fx);
+                da_append(rom, 0);
+            }
+        } else {
+            int instruction = code_c_command(line);
+            if (instruction < 0) { result = -1; goto defer; }
+            da_append(rom, instruction);
+        }
+    }
+    t->rom = rom->count;
+
+    backpatch(t, rom, &fixups);
+
+defer:
+    da_free(fixups);
+    sb_free(clean);
+    return result;
+}
+
+int assembler_single_pass(HashTable *t, const char *path, Output_Format format) {
+    Mapped_File f;
+    if (!map_file(path, &f)) {
+        perror("Error opening file (input)");
+        return -1;
+    }
+
+    Rom rom = {0};
+    int result = assemble_source(t, mf_to_sv(f), &rom);
+    if (result == 0) result = write_rom(&rom, path, format);
+
+    da_free(rom);
+    unmap_file(&f);
+    return result;
 }
 
 int build_symtable(HashTable *t, const char *path) {
-    FILE *f = fopen(path, "r");
-    if (f == NULL) {
+    Mapped_File f;
+    if (!map_file(path, &f)) {
         perror("Error opening file (input)");
         return -1;
     }
 
-    char line[256];
-    while(fgets(line, sizeof(line), f) != NULL) {
-        remove_whitespace(line);
-        remove_comment(line);
-        if (line[0] == '\0') continue;
+    String_Builder clean = {0};
+    collect_labels(t, clean_source(mf_to_sv(f), &clean));
+
+    sb_free(clean);
+    unmap_file(&f);
+    return 0;
+}
+
+int assembler_stream(HashTable *t, FILE *in, FILE *out, Output_Format format, bool single_pass) {
+    String_Builder source = {0};
+    if (!read_stream(in, &source)) {
+        perror("Error reading (input)");
+        sb_free(source);
+        return -1;
+    }
+
+    Writer w;
+    if (!writer_open_stream(&w, out, format == OUTPUT_BIN)) {
+        perror("Error opening (output)");
+        sb_free(source);
+        return -1;
+    }
+
+    int result;
+    if (single_pass) {
+        Rom rom = {0};
+        result = assemble_source(t, sb_to_sv(source), &rom);
+        if (result == 0) da_foreach(uint16_t, word, &rom) write_word(&w, format, *word);
+        da_free(rom);
+    } else {
+        // the input cannot be read twice: both passes run over the same cleaned copy
+        String_Builder clean = {0};
+        String_View cleaned = clean_source(sb_to_sv(source), &clean);
+        collect_labels(t, cleaned);
+        result = encode_source(t, cleaned, &w, format);
+        sb_free(clean);
+    }
+
+    sb_free(source);
+    if (!writer_close(&w)) { perror("Error writing (output)"); result = -1; }
+    return result;
+}
+
+// ---------------------------------------------------------------------------------------
+// Parallel two-pass assembler
+
+// Label found by a chunk, relative to the first instruction of the chunk
+typedef struct {
+    String_View sym;
+    size_t rom_offset;
+} Label;
+
+typedef struct {
+    Label *items;
+    size_t count;
+    size_t capacity;
+} Labels;
+
+// Line-aligned slice of the file handled by one thread
+typedef struct {
+    String_View source; // raw slice of the file, then its cleaned text after pass 1
+    HashTable *t;       // read-only while the chunks run
+    Rom *rom;           // shared: each chunk writes only its own range
+    size_t rom_count;   // pass 1: instructions in the chunk
+    size_t rom_base;    // address of the first instruction of the chunk
+    Labels labels;      // pass 1
+    Fixups fixups;      // pass 2: symbols that are not labels nor predefined
+    String_Builder clean;
+    int failed;
+} Chunk;
+
+// Pass 1: count the instructions and collect the labels of the chunk
+static void chunk_first_pass(void *arg) {
+    Chunk *c = arg;
+    c->source = clean_source(c->source, &c->clean);
+    String_View source = c->source;
+    String_View line;
+    while (next_line(&source, &line)) {
+        CommandType ct = command_type(line);
+        if (ct == L_COMMAND) {
+            Label label = {symbol(line), c->rom_count};
+            da_append(&c->labels, label);
+        } else {
+            c->rom_count++;
+        }
+    }
+}
+
+// Pass 2: encode the chunk into its range of the ROM. Variables are left as fixups,
+// because their RAM address depends on the order of first use in the whole file.
+static void chunk_second_pass(void *arg) {
+    Chunk *c = arg;
+    String_View source = c->source;
+    String_View line;
+    size_t pc = c->rom_base;
+    while (next_line(&source, &line)) {
         CommandType ct = command_type(line);
-        if (ct == A_COMMAND || ct == C_COMMAND) t->rom++;
-        if (ct == L_COMMAND) add_entry(t, symbol(line), t->rom);
+        if (ct == A_COMMAND) {
+            String_View sym = symbol(line);
+            int instruction = 0;
+            if (is_number(sym)) {
+                instruction = number(sym) & 0x7FFF;
+            } else if (contains_sv(c->t, sym)) {
+                instruction = get_address_sv(c->t, sym) & 0x7FFF;
+            } else {
+                Fixup fx = {pc, sym};
+                da_append(&c->fixups, fx);
+            }
+            c->rom->items[pc++] = instruction;
+        } else if (ct == C_COMMAND) {
+            int instruction = code_c_command(line);
+            if (instruction < 0) { c->failed = 1; break; }
+            c->rom->items[pc++] = instruction;
+        }
     }
+}
 
-    fclose(f);
-    return 0;
-}
\ No newline at end of file
+static void run_chunks(Chunk *chunks, int n, Thread_Fn fn) {
+    Thread *threads = malloc(n * sizeof(Thread));
+    assert(threads != NULL && "More RAM!");
+    int started = 0;
+    for (int i = 1; i < n; ++i, ++started) {
+        if (!thread_start(&threads[i], fn, &chunks[i])) break;
+    }
+    fn(&chunks[0]);
+    for (int i = 1; i <= started; ++i) {
+        thread_join(threads[i]);
+    }
+    // chunks that could not get a thread run here
+    for (int i = started + 1; i < n; ++i) {
+        fn(&chunks[i]);
+    }
+    free(threads);
+}
+
+int assembler_parallel(HashTable *t, const char *path, Output_Format format, int threads) {
+    Mapped_File f;
+    if (!map_file(path, &f)) {
+        perror("Error opening file (input)");
+        return -1;
+    }
+
+    if (threads <= 0) threads = cpu_count();
+    // small files are not worth a thread per core
+    size_t max_chunks = f.count / PARALLEL_MIN_CHUNK + 1;
+    if ((size_t)threads > max_chunks) threads = (int)max_chunks;
+
+    Rom rom = {0};
+    Chunk *chunks = calloc(threads, sizeof(Chunk));
+    assert(chunks != NULL && "More RAM!");
+
+    // split the file at line boundaries
+    String_View rest = mf_to_sv(f);
+    for (int i = 0; i < threads; ++i) {
+        size_t size = rest.count / (threads - i);
+        if (i == threads - 1) size = rest.count;
+        const char *nl = size < rest.count ? memchr(rest.data + size, '\n', rest.count - size) : NULL;
+        size = nl ? (size_t)(nl - rest.data) + 1 : rest.count;
+        chunks[i].source = sv_from_parts(rest.data, size);
+        chunks[i].t = t;
+        chunks[i].rom = &rom;
+        rest = sv_from_parts(rest.data + size, rest.count - size);
+    }
+
+    run_chunks(chunks, threads, chunk_first_pass);
+
+    // prefix sum of the instruction counts gives the global address of every label
+    size_t pc = 0;
+    for (int i = 0; i < threads; ++i) {
+        chunks[i].rom_base = pc;
+        da_foreach(Label, label, &chunks[i].labels) {
+            add_symbol_sv(t, label->sym, pc + label->rom_offset, SYMBOL_LABEL);
+        }
+        pc += chunks[i].rom_count;
+    }
+    t->rom = pc;
+
+    da_reserve(&rom, pc);
+    rom.count = pc;
+
+    run_chunks(chunks, threads, chunk_second_pass);
+
+    int result = 0;
+    for (int i = 0; i < threads; ++i) {
+        if (chunks[i].failed) result = -1;
+    }
+    if (result == 0) {
+        for (int i = 0; i < threads; ++i) backpatch(t, &rom, &chunks[i].fixups);
+        result = write_rom(&rom, path, format);
+    }
+
+    for (int i = 0; i < threads; ++i) {
+        da_free(chunks[i].labels);
+        da_free(chunks[i].fixups);
+        sb_free(chunks[i].clean);
+    }
+    free(chunks);
+    da_free(rom);
+    unmap_file(&f);
+    return result;
+}
@@ -2,8 +2,48 @@
 #define PARSER_H_
 
 #include "SymbolTable.h"
+#include "Utils.h"
 
-int assembler(HashTable *t, const char *path);
+// Assembled program: one 16-bit word per instruction
+typedef struct {
+    uint16_t *items;
+    size_t count;
+    size_t capacity;
+} Rom;
+
+// Format of the assembled program, written next to the .asm file
+typedef enum {
+    OUTPUT_HACK, // .hack: one word per line as 16 ASCII '0'/'1'
+    OUTPUT_BIN,  // .bin:  raw packed 16-bit words, little-endian, no header
+    OUTPUT_HEX   // .hex:  one word per line as 4 hexadecimal digits
+} Output_Format;
+
+// Name of a file written next to the .asm: same path with ext instead of ".asm" (malloc'ed, NULL on error)
+char* output_name(const char *input_filename, const char *ext);
+
+int assembler(HashTable *t, const char *path, Output_Format format);
 int build_symtable(HashTable *t, const char *path);
 
-#endif // PARSER_H_
\ No newline at end of file
+// Reads the .asm file only once: instructions are emitted into an in-memory ROM and
+// the A-instructions that reference still unknown symbols are backpatched at the end.
+int assembler_single_pass(HashTable *t, const char *path, Output_Format format);
+
+// Single-pass assembly of an in-memory source into rom, without any file I/O
+int assemble_source(HashTable *t, String_View source, Rom *rom);
+int write_rom(const Rom *rom, const char *path, Output_Format format);
+
+// Reads the whole program from in (stdin) and writes the ROM to out (stdout) through the large
+// output buffer, so the assembler can sit in a pipeline. The two-pass mode keeps the cleaned text
+// in memory and runs both passes over it.
+int assembler_stream(HashTable *t, FILE *in, FILE *out, Output_Format format, bool single_pass);
+
+// Two-pass assembler over line-aligned chunks of the file, one thread per chunk (threads <= 0: one
+// per core). Pass 1 counts instructions and collects labels per chunk, a prefix sum gives the global
+// addresses, pass 2 encodes the chunks into a shared ROM. Variables are still allocated in order of
+// first use, so the output is identical to assembler().
+#ifndef PARALLEL_MIN_CHUNK
+#define PARALLEL_MIN_CHUNK (256*1024)
+#endif
+int assembler_parallel(HashTable *t, const char *path, Output_Format format, int threads);
+
+#endif // PARSER_H_
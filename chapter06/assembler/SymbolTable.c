@@ -1,33 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <ctype.h>
 #include <string.h>
 
 #include "SymbolTable.h"
 
-// MACROS
-
-// DYNAMIC ARRAY --- BUCKETS
-#define da_append(xs, x)\
-    do {\
-    if ((xs)->count >= (xs)->capacity) {\
-        if ((xs)->capacity == 0) (xs)->capacity = 128;\
-        else (xs)->capacity *= 2;\
-        (xs)->items = realloc((xs)->items, (xs)->capacity * sizeof(*(xs)->items));\
-    }\
-    (xs)->items[(xs)->count++] = (x);\
-    } while(0)
-
-#define da_free(xs) free((xs).items)
-
-// ---------------------------------------------------------------------------------------
-
-// ENUM
-// Since all three operations use the same function, this enum is used as a control.
-typedef enum { INSERT, CONTAINS, GET } Operation;
-
-// ---------------------------------------------------------------------------------------
-
 // Functions
 
 static void rehash(HashTable *t);
@@ -36,11 +12,10 @@ HashTable* create_table() {
     HashTable *t = malloc(sizeof(HashTable));
     if (!t) return NULL;
     t->T = TABLE_SIZE;
-    t->collisions = 0;
-    
     t->table = calloc(t->T, sizeof(Entry));
-    t->buckets = calloc(t->T, sizeof(Bucket));
+    if (!t->table) { free(t); return NULL; }
     t->count = 0;
+    t->keys = (Arena){0};
     t->rom = 0;
     t->ram = 16;
 
@@ -72,109 +47,158 @@ HashTable* create_table() {
     return t;
 }
 
-static size_t hash(const unsigned char *str) {
-    size_t hash = 5381;
-    while (*str) {
-        hash = ((hash << 5) + hash) + (*str++);
+HashTable* clone_table(const HashTable *src) {
+    HashTable *t = malloc(sizeof(HashTable));
+    if (!t) return NULL;
+    *t = *src;
+    t->keys = (Arena){0};
+    t->table = malloc(t->T * sizeof(Entry));
+    if (!t->table) { free(t); return NULL; }
+
+    // same slots, keys copied into the arena of the clone
+    for (size_t i = 0; i < t->T; ++i) {
+        t->table[i] = src->table[i];
+        if (src->table[i].key == NULL) continue;
+        char *key = arena_alloc(&t->keys, src->table[i].len + 1);
+        memcpy(key, src->table[i].key, src->table[i].len + 1);
+        t->table[i].key = key;
+    }
+    return t;
+}
+
+// FNV-1a: unlike djb2, its low bits are well mixed, and the slot is taken from the low bits
+static uint32_t hash(String_View str) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < str.count; ++i) {
+        hash ^= (unsigned char)str.data[i];
+        hash *= 16777619u;
     }
     return hash;
 }
 
-static int insert_internal(HashTable *t, unsigned char *key, int addr, Operation flag) {
-    size_t i = hash(key) % t->T;
+// distance of the slot i from the home slot of the entry stored there
+static size_t displacement(const HashTable *t, size_t i) {
+    return (i - (t->table[i].hash & (t->T - 1))) & (t->T - 1);
+}
 
-    if (t->table[i].key == NULL) {
-        if (flag == CONTAINS) return 0;  // contains? no! -> return false
-        if (flag == GET) return -1; // symbol isn't in table -> return -1 as error control;
-        if (flag == INSERT) {
-            t->table[i].key = strdup((char *)key);
-            t->table[i].address = addr;
-            t->count++;
-            return addr;
-        }
-    } else if (strcmp((char *)t->table[i].key, (char *)key) == 0) {
-        if (flag == CONTAINS) return 1; // contains? yes! -> return true
-        if (flag == GET) return t->table[i].address; // symbol is in table -> return address;
-        if (flag == INSERT && t->table[i].address != addr) t->table[i].address = addr;
-    } else {
-        for (size_t j = 0; j < t->buckets[i].count; ++j) {
-            if (strcmp((char *)t->buckets[i].items[j].key, (char *)key) == 0) {
-                if (flag == CONTAINS) return 1; // contains? yes! -> return true
-                if (flag == GET) return t->buckets[i].items[j].address; // symbol is in table -> return address;
-            }
+// Returns the slot holding the symbol or -1. With Robin Hood ordering, the search can stop
+// as soon as it reaches an entry that is closer to its home slot than the symbol would be.
+static long find_slot(const HashTable *t, String_View symbol, uint32_t h) {
+    size_t mask = t->T - 1;
+    size_t i = h & mask;
+    for (size_t dist = 0; ; ++dist, i = (i + 1) & mask) {
+        const Entry *e = &t->table[i];
+        if (e->key == NULL || displacement(t, i) < dist) return -1;
+        if (e->hash == h && e->len == symbol.count && memcmp(e->key, symbol.data, symbol.count) == 0)
+            return (long)i;
+    }
+}
+
+// Places a new entry, displacing the entries that are closer to their home slot (Robin Hood)
+static void place(HashTable *t, Entry entry) {
+    size_t mask = t->T - 1;
+    size_t i = entry.hash & mask;
+    for (size_t dist = 0; ; ++dist, i = (i + 1) & mask) {
+        if (t->table[i].key == NULL) {
+            t->table[i] = entry;
+            return;
         }
-        if (flag == CONTAINS) return 0;  // contains? no! -> return false
-        if (flag == GET) return -1; // symbol isn't in table -> return -1 as error control;
-
-        if (flag == INSERT) {
-            Entry new_entry = {strdup((char *)key), addr};
-            da_append(&t->buckets[i], new_entry);
-            t->collisions++;
-            t->count++;
-            return addr;
+        size_t other = displacement(t, i);
+        if (other < dist) {
+            Entry tmp = t->table[i];
+            t->table[i] = entry;
+            entry = tmp;
+            dist = other;
         }
     }
 }
 
-void add_entry(HashTable *t, unsigned char *symbol, int address) {
+void add_symbol_sv(HashTable *t, String_View symbol, int address, Symbol_Kind kind) {
+    uint32_t h = hash(symbol);
+    long i = find_slot(t, symbol, h);
+    if (i >= 0) {
+        t->table[i].address = address;
+        t->table[i].kind = kind;
+        return;
+    }
+
     if ((double)(t->count + 1) / t->T > LOAD_FACTOR) {
         rehash(t);
     }
-    insert_internal(t, symbol, address, INSERT);
+
+    // keys are interned in the arena, NULL-terminated
+    char *key = arena_alloc(&t->keys, symbol.count + 1);
+    memcpy(key, symbol.data, symbol.count);
+    key[symbol.count] = '\0';
+
+    Entry entry = { key, (uint32_t)symbol.count, h, address, kind };
+    place(t, entry);
+    t->count++;
+}
+
+void add_entry_sv(HashTable *t, String_View symbol, int address) {
+    add_symbol_sv(t, symbol, address, SYMBOL_PREDEFINED);
+}
+
+int contains_sv(HashTable *t, String_View symbol) {
+    return find_slot(t, symbol, hash(symbol)) >= 0;
+}
+
+const Entry *find_entry_sv(const HashTable *t, String_View symbol) {
+    long i = find_slot(t, symbol, hash(symbol));
+    return i < 0 ? NULL : &t->table[i];
+}
+
+int get_address_sv(HashTable *t, String_View symbol) {
+    long i = find_slot(t, symbol, hash(symbol));
+    return i < 0 ? -1 : t->table[i].address; // symbol isn't in table -> return -1 as error control;
+}
+
+void add_entry(HashTable *t, unsigned char *symbol, int address) {
+    add_entry_sv(t, sv_from_cstr((char *)symbol), address);
 }
 
 int contains(HashTable *t, unsigned char *symbol) {
-    return insert_internal(t, symbol, -1, CONTAINS);
+    return contains_sv(t, sv_from_cstr((char *)symbol));
 }
 
 int get_address(HashTable *t, unsigned char *symbol) {
-    return insert_internal(t, symbol, -1, GET);
+    return get_address_sv(t, sv_from_cstr((char *)symbol));
 }
 
+// Keys stay in the arena and hashes are cached: growing only moves the slots
 static void rehash(HashTable *t) {
     size_t old_T = t->T;
     Entry *old_table = t->table;
-    Bucket *old_buckets = t->buckets;
 
     t->T *= 2;
     t->table = calloc(t->T, sizeof(Entry));
-    t->buckets = calloc(t->T, sizeof(Bucket));
-    t->count = 0;
-    t->collisions = 0;
+    assert(t->table != NULL && "More RAM!");
 
     for (size_t i = 0; i < old_T; ++i) {
-        if (old_table[i].key != NULL) {
-            insert_internal(t, old_table[i].key, old_table[i].address, INSERT);
-            free(old_table[i].key);
-        }
-
-        for (size_t j = 0; j < old_buckets[i].count; ++j) {
-            insert_internal(t,
-                            old_buckets[i].items[j].key,
-                            old_buckets[i].items[j].address,
-                            INSERT);
-            free(old_buckets[i].items[j].key);
-        }
-
-        da_free(old_buckets[i]);
+        if (old_table[i].key != NULL) place(t, old_table[i]);
     }
 
     free(old_table);
-    free(old_buckets);
+}
+
+Probe_Stats probe_stats(const HashTable *t) {
+    Probe_Stats stats = {0};
+    stats.count = t->count;
+    stats.capacity = t->T;
+    for (size_t i = 0; i < t->T; ++i) {
+        if (t->table[i].key == NULL) continue;
+        size_t probes = displacement(t, i) + 1;
+        stats.total_probes += probes;
+        if (probes > stats.max_probe) stats.max_probe = probes;
+        if (probes > 1) stats.collisions++;
+    }
+    return stats;
 }
 
 void free_table(HashTable *table) {
     if (!table) return;
-    
-    for (size_t i = 0; i < table->T; ++i) {
-        free(table->table[i].key);
-        for (size_t j = 0; j < table->buckets[i].count; ++j) {
-            free(table->buckets[i].items[j].key);
-        }
-        da_free(table->buckets[i]);
-    }
-    
+    arena_free(&table->keys);
     free(table->table);
-    free(table->buckets);
     free(table);
-}
\ No newline at end of file
+}
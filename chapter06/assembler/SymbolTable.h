@@ -3,42 +3,72 @@
 
 #include <stddef.h>
 
+#include "Utils.h"
+
 // STRUCTS
 
-// Entry (symbol, address) as an entry for the Symbol Table
+// What a symbol stands for
+typedef enum {
+    SYMBOL_PREDEFINED,  // SP, R0..R15, SCREEN, ... (and any symbol added with add_entry)
+    SYMBOL_LABEL,       // (LABEL): ROM address
+    SYMBOL_VARIABLE     // RAM address allocated on first use
+} Symbol_Kind;
+
+// Entry (symbol, address) as a slot of the Symbol Table.
+// The key lives in the table arena and its hash is cached, so probing and rehashing
+// only compare the full key when the hashes match.
 typedef struct {
-    unsigned char *key;
+    const char *key;   // NULL: empty slot
+    uint32_t len;
+    uint32_t hash;
     int address;
+    Symbol_Kind kind;
 } Entry;
 
-// Dynamic array specification as Symbol Table collision control
-typedef struct {
-    Entry *items;
-    size_t count;
-    size_t capacity;
-} Bucket;
-
-// Hash Table specification
-#define TABLE_SIZE 2048
+// Hash Table specification: open addressing with Robin Hood linear probing
+#define TABLE_SIZE 64      // power of two
 #define LOAD_FACTOR 0.75
 
 typedef struct {
     size_t T;
     Entry *table;
-    Bucket *buckets;
     size_t count;
-    size_t collisions;
+    Arena keys;
 
     size_t rom;
     size_t ram;
 } HashTable;
 
+// Probe lengths of the stored keys: how many slots a successful lookup visits
+typedef struct {
+    size_t count;
+    size_t capacity;
+    size_t total_probes;
+    size_t max_probe;
+    size_t collisions;  // keys not stored in their home slot
+} Probe_Stats;
+
 HashTable* create_table();
 void free_table(HashTable *table);
 
+// Independent copy of a table (e.g. the predefined symbols shared by many assemblies)
+HashTable* clone_table(const HashTable *table);
+
 // operations
 void add_entry(HashTable *t, unsigned char *symbol, int address);
 int contains(HashTable *t, unsigned char *symbol);
 int get_address(HashTable *t, unsigned char *symbol);
 
+// same operations for symbols that are slices of a line (not NULL-terminated)
+void add_entry_sv(HashTable *t, String_View symbol, int address);
+int contains_sv(HashTable *t, String_View symbol);
+int get_address_sv(HashTable *t, String_View symbol);
+
+// add_entry_sv() for program symbols, recording what they are
+void add_symbol_sv(HashTable *t, String_View symbol, int address, Symbol_Kind kind);
+// Entry of the symbol, NULL if it is not in the table. Valid until the next insertion.
+const Entry *find_entry_sv(const HashTable *t, String_View symbol);
+
+Probe_Stats probe_stats(const HashTable *t);
+
 #endif // SYMBOLTABLE_H_
\ No newline at end of file
@@ -0,0 +1,442 @@
+/* This is a modification and extension of: nob - v1.23.0 - Public Domain - https://github.com/tsoding/nob.h */
+
+#include "Utils.h"
+
+UDEF String_View sv_from_parts(const char *data, size_t count) {
+    String_View sv;
+    sv.count = count;
+    sv.data = data;
+    return sv;
+}
+
+UDEF String_View sv_chop_by_delim(String_View *sv, char delim) {
+    const char *p = sv->count > 0 ? memchr(sv->data, delim, sv->count) : NULL;
+    size_t i = p ? (size_t)(p - sv->data) : sv->count;
+
+    String_View result = sv_from_parts(sv->data, i);
+
+    if (i < sv->count) {
+        sv->count -= i + 1;
+        sv->data  += i + 1;
+    } else {
+        sv->count -= i;
+        sv->data  += i;
+    }
+
+    return result;
+}
+
+UDEF String_View sv_trim_left(String_View sv) {
+    size_t i = 0;
+    while (i < sv.count && isspace((unsigned char)sv.data[i])) i += 1;
+    return sv_from_parts(sv.data + i, sv.count - i);
+}
+
+UDEF String_View sv_trim_right(String_View sv) {
+    size_t i = 0;
+    while (i < sv.count && isspace((unsigned char)sv.data[sv.count - 1 - i])) i += 1;
+    return sv_from_parts(sv.data, sv.count - i);
+}
+
+UDEF String_View sv_trim(String_View sv) {
+    return sv_trim_right(sv_trim_left(sv));
+}
+
+UDEF String_View sv_from_cstr(const char *cstr) {
+    return sv_from_parts(cstr, strlen(cstr));
+}
+
+UDEF bool sv_eq(String_View a, String_View b) {
+    if (a.count != b.count) {
+        return false;
+    } else {
+        return memcmp(a.data, b.data, a.count) == 0;
+    }
+}
+
+UDEF String_View sv_strip_comment(String_View sv) {
+    size_t i;
+    bool found = false;
+
+    for (i = 0; i + 1 < sv.count; ++i) {
+        if (sv.data[i] == '/' && sv.data[i + 1] == '/') {
+            found = true;
+            break;
+        }
+    }
+    if (found) sv.count = i;
+    return sv_trim(sv);
+}
+
+UDEF bool map_file(const char *path, Mapped_File *mf) {
+    mf->data = NULL;
+    mf->count = 0;
+
+#ifdef _WIN32
+    mf->file = INVALID_HANDLE_VALUE;
+    mf->mapping = NULL;
+
+    mf->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mf->file == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "ERROR: Could not open file %s: %lu\n", path, GetLastError());
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mf->file, &size)) {
+        fprintf(stderr, "ERROR: Could not get size of file %s: %lu\n", path, GetLastError());
+        unmap_file(mf);
+        return false;
+    }
+
+    // an empty file cannot be mapped, it is just an empty view
+    if (size.QuadPart == 0) {
+        mf->data = "";
+        return true;
+    }
+
+    mf->mapping = CreateFileMappingA(mf->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mf->mapping == NULL) {
+        fprintf(stderr, "ERROR: Could not map file %s: %lu\n", path, GetLastError());
+        unmap_file(mf);
+        return false;
+    }
+
+    mf->data = MapViewOfFile(mf->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (mf->data == NULL) {
+        fprintf(stderr, "ERROR: Could not map file %s: %lu\n", path, GetLastError());
+        unmap_file(mf);
+        return false;
+    }
+    mf->count = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: Could not open file %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "ERROR: Could not get size of file %s: %s\n", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    // an empty file cannot be mapped, it is just an empty view
+    if (st.st_size == 0) {
+        close(fd);
+        mf->data = "";
+        return true;
+    }
+
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "ERROR: Could not map file %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    // the file is read from the beginning to the end, once per pass
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mf->data = p;
+    mf->count = (size_t)st.st_size;
+#endif
+
+    return true;
+}
+
+UDEF void unmap_file(Mapped_File *mf) {
+#ifdef _WIN32
+    if (mf->count > 0 && mf->data) UnmapViewOfFile(mf->data);
+    if (mf->mapping) CloseHandle(mf->mapping);
+    if (mf->file != INVALID_HANDLE_VALUE) CloseHandle(mf->file);
+    mf->mapping = NULL;
+    mf->file = INVALID_HANDLE_VALUE;
+#else
+    if (mf->count > 0) munmap((void *)mf->data, mf->count);
+#endif
+    mf->data = NULL;
+    mf->count = 0;
+}
+
+UDEF bool read_stream(FILE *in, String_Builder *sb) {
+#ifdef _WIN32
+    // keep the bytes as they are, the cleaner already drops '\r'
+    _setmode(_fileno(in), _O_BINARY);
+#endif
+    for (;;) {
+        da_reserve(sb, sb->count + READ_CHUNK);
+        size_t n = fread(sb->items + sb->count, 1, READ_CHUNK, in);
+        sb->count += n;
+        if (n < READ_CHUNK) return !ferror(in);
+    }
+}
+
+UDEF void *arena_alloc(Arena *a, size_t size) {
+    Arena_Block *b = a->head;
+    if (!b || b->count + size > b->capacity) {
+        size_t capacity = size > ARENA_BLOCK_CAP ? size : ARENA_BLOCK_CAP;
+        b = malloc(sizeof(Arena_Block) + capacity);
+        assert(b != NULL && "More RAM!");
+        b->next = a->head;
+        b->count = 0;
+        b->capacity = capacity;
+        a->head = b;
+    }
+    void *p = b->data + b->count;
+    b->count += size;
+    return p;
+}
+
+UDEF void arena_free(Arena *a) {
+    Arena_Block *b = a->head;
+    while (b) {
+        Arena_Block *next = b->next;
+        free(b);
+        b = next;
+    }
+    a->head = NULL;
+}
+
+UDEF bool writer_open(Writer *w, const char *path, bool binary) {
+    w->count = 0;
+    w->failed = false;
+    w->items = malloc(WRITER_CAP);
+    if (!w->items) return false;
+    w->out = fopen(path, binary ? "wb" : "w");
+    if (!w->out) {
+        free(w->items);
+        w->items = NULL;
+        return false;
+    }
+    w->owned = true;
+    return true;
+}
+
+UDEF bool writer_open_stream(Writer *w, FILE *out, bool binary) {
+#ifdef _WIN32
+    // stdout is opened in text mode: '\n' would become "\r\n" inside the packed words
+    if (binary && _setmode(_fileno(out), _O_BINARY) == -1) return false;
+#else
+    (void)binary;
+#endif
+    w->count = 0;
+    w->failed = false;
+    w->items = malloc(WRITER_CAP);
+    if (!w->items) return false;
+    w->out = out;
+    w->owned = false;
+    return true;
+}
+
+UDEF void writer_write(Writer *w, const void *data, size_t size) {
+    if (w->count + size > WRITER_CAP) {
+        writer_flush(w);
+        if (size > WRITER_CAP) {
+            if (fwrite(data, 1, size, w->out) != size) w->failed = true;
+            return;
+        }
+    }
+    memcpy(w->items + w->count, data, size);
+    w->count += size;
+}
+
+UDEF bool writer_flush(Writer *w) {
+    if (w->count == 0) return true;
+    size_t written = fwrite(w->items, 1, w->count, w->out);
+    bool ok = written == w->count;
+    if (!ok) w->failed = true;
+    w->count = 0;
+    return ok;
+}
+
+UDEF bool writer_close(Writer *w) {
+    bool ok = writer_flush(w) && !w->failed;
+    if ((w->owned ? fclose(w->out) : fflush(w->out)) != 0) ok = false;
+    free(w->items);
+    w->items = NULL;
+    w->out = NULL;
+    return ok;
+}
+
+typedef struct {
+    Thread_Fn fn;
+    void *arg;
+} Thread_Start;
+
+#ifdef _WIN32
+static DWORD WINAPI thread_entry(LPVOID p) {
+#else
+static void *thread_entry(void *p) {
+#endif
+    Thread_Start start = *(Thread_Start *)p;
+    free(p);
+    start.fn(start.arg);
+    return 0;
+}
+
+UDEF bool thread_start(Thread *th, Thread_Fn fn, void *arg) {
+    Thread_Start *start = malloc(sizeof(Thread_Start));
+    if (!start) return false;
+    start->fn = fn;
+    start->arg = arg;
+#ifdef _WIN32
+    *th = CreateThread(NULL, 0, thread_entry, start, 0, NULL);
+    if (*th == NULL) { free(start); return false; }
+#else
+    if (pthread_create(th, NULL, thread_entry, start) != 0) { free(start); return false; }
+#endif
+    return true;
+}
+
+UDEF void thread_join(Thread th) {
+#ifdef _WIN32
+    WaitForSingleObject(th, INFINITE);
+    CloseHandle(th);
+#else
+    pthread_join(th, NULL);
+#endif
+}
+
+UDEF int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+UDEF void mutex_init(Mutex *m) {
+#ifdef _WIN32
+    InitializeCriticalSection(m);
+#else
+    pthread_mutex_init(m, NULL);
+#endif
+}
+
+UDEF void mutex_lock(Mutex *m) {
+#ifdef _WIN32
+    EnterCriticalSection(m);
+#else
+    pthread_mutex_lock(m);
+#endif
+}
+
+UDEF void mutex_unlock(Mutex *m) {
+#ifdef _WIN32
+    LeaveCriticalSection(m);
+#else
+    pthread_mutex_unlock(m);
+#endif
+}
+
+UDEF void mutex_destroy(Mutex *m) {
+#ifdef _WIN32
+    DeleteCriticalSection(m);
+#else
+    pthread_mutex_destroy(m);
+#endif
+}
+
+UDEF double now_seconds(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+UDEF bool is_directory(const char *path) {
+#ifdef _WIN32
+    DWORD attr = GetFileAttributesA(path);
+    return attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+UDEF char *replace_extension(const char *path, const char *ext) {
+    const char *dot = strrchr(path, '.');
+    const char *sep = strrchr(path, '/');
+    const char *bsep = strrchr(path, '\\');
+    if (bsep > sep) sep = bsep;
+    size_t base = dot && dot > sep ? (size_t)(dot - path) : strlen(path);
+
+    char *result = malloc(base + strlen(ext) + 1);
+    assert(result != NULL && "More RAM!");
+    memcpy(result, path, base);
+    strcpy(result + base, ext);
+    return result;
+}
+
+static bool ends_with(const char *s, const char *ext) {
+    size_t n = strlen(s), m = strlen(ext);
+    return n >= m && strcmp(s + n - m, ext) == 0;
+}
+
+static void append_path(Paths *paths, const char *dirpath, const char *name, char sep) {
+    size_t size = strlen(dirpath) + 1 + strlen(name) + 1;
+    char *path = malloc(size);
+    assert(path != NULL && "More RAM!");
+    snprintf(path, size, "%s%c%s", dirpath, sep, name);
+    da_append(paths, path);
+}
+
+UDEF bool dir_files(const char *dirpath, const char *ext, Paths *paths) {
+#ifdef _WIN32
+    WIN32_FIND_DATA find_data;
+    char search_path[MAX_PATH];
+    snprintf(search_path, sizeof(search_path), "%s\\*", dirpath);
+
+    HANDLE hfind = FindFirstFile(search_path, &find_data);
+    if (hfind == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "ERROR: Could not open directory %s\n", dirpath);
+        return false;
+    }
+
+    do {
+        if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && ends_with(find_data.cFileName, ext))
+            append_path(paths, dirpath, find_data.cFileName, '\\');
+    } while (FindNextFile(hfind, &find_data) != 0);
+
+    FindClose(hfind);
+#else
+    DIR *dir = opendir(dirpath);
+    if (!dir) {
+        fprintf(stderr, "ERROR: Could not open directory %s: %s\n", dirpath, strerror(errno));
+        return false;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!ends_with(entry->d_name, ext)) continue;
+        size_t first = paths->count;
+        append_path(paths, dirpath, entry->d_name, '/');
+        // d_type is not filled by every file system
+        if (entry->d_type != DT_REG && (entry->d_type != DT_UNKNOWN || is_directory(paths->items[first]))) {
+            free(paths->items[first]);
+            paths->count = first;
+        }
+    }
+
+    closedir(dir);
+#endif
+    return true;
+}
+
+UDEF void free_paths(Paths *paths) {
+    da_foreach(char *, path, paths) free(*path);
+    da_free(*paths);
+    *paths = (Paths){0};
+}
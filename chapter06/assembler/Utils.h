@@ -0,0 +1,213 @@
+/* This is a modification and extension of: nob - v1.23.0 - Public Domain - https://github.com/tsoding/nob.h */
+
+#ifndef UTILS_H_
+#define UTILS_H_
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS (1)
+#endif
+
+#ifndef UDEF
+/*
+   Goes before declarations and definitions of the functions. Useful to `#define UDEF static inline`
+   if your source code is a single file and you want the compiler to remove unused functions.
+*/
+#define UDEF
+#endif /* UDEF */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#    include <io.h>
+#    include <fcntl.h>
+#else
+#    include <sys/types.h>
+#    include <sys/stat.h>
+#    include <sys/mman.h>
+#    include <unistd.h>
+#    include <fcntl.h>
+#    include <pthread.h>
+#    include <dirent.h>
+#    include <time.h>
+#endif
+
+// Initial capacity of a dynamic array
+#ifndef DA_INIT_CAP
+#define DA_INIT_CAP 256
+#endif
+
+#define da_reserve(da, expected_capacity)                                                      \
+    do {                                                                                       \
+        if ((expected_capacity) > (da)->capacity) {                                            \
+            if ((da)->capacity == 0) {                                                         \
+                (da)->capacity = DA_INIT_CAP;                                                  \
+            }                                                                                  \
+            while ((expected_capacity) > (da)->capacity) {                                     \
+                (da)->capacity *= 2;                                                           \
+            }                                                                                  \
+            (da)->items = realloc((da)->items, (da)->capacity * sizeof(*(da)->items));         \
+            assert((da)->items != NULL && "More RAM!");                                        \
+        }                                                                                      \
+    } while (0)                                                                                \
+
+#define da_append(da, item)                  \
+    do {                                     \
+        da_reserve((da), (da)->count + 1);   \
+        (da)->items[(da)->count++] = (item); \
+    } while (0)                              \
+
+#define da_free(da) free((da).items)
+
+#define da_append_many(da, new_items, new_items_count)                                            \
+    do {                                                                                          \
+        da_reserve((da), (da)->count + (new_items_count));                                        \
+        memcpy((da)->items + (da)->count, (new_items), (new_items_count) * sizeof(*(da)->items)); \
+        (da)->count += (new_items_count);                                                         \
+    } while (0)                                                                                   \
+
+#define da_foreach(Type, it, da) for (Type *it = (da)->items; it < (da)->items + (da)->count; ++it)
+
+typedef struct {
+    char *items;
+    size_t count;
+    size_t capacity;
+} String_Builder;
+
+// Append a sized buffer to a string builder
+#define sb_append_buf(sb, buf, size) da_append_many(sb, buf, size)
+
+// Free the memory allocated by a string builder
+#define sb_free(sb) free((sb).items)
+
+#define SV_Fmt "%.*s"
+#define SV_Arg(sv) (int)(sv).count, (sv).data
+
+typedef struct {
+    size_t count;
+    const char *data;
+} String_View;
+
+// sb_to_sv() enables you to just view String_Builder as String_View
+#define sb_to_sv(sb) sv_from_parts((sb).items, (sb).count)
+
+UDEF String_View sv_from_parts(const char *data, size_t count);
+UDEF String_View sv_chop_by_delim(String_View *sv, char delim);
+UDEF String_View sv_trim_left(String_View sv);
+UDEF String_View sv_trim_right(String_View sv);
+UDEF String_View sv_trim(String_View sv);
+UDEF String_View sv_from_cstr(const char *cstr);
+UDEF bool sv_eq(String_View a, String_View b);
+UDEF String_View sv_strip_comment(String_View sv);
+
+// Read-only view of a whole file mapped into memory
+typedef struct {
+    const char *data;
+    size_t count;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} Mapped_File;
+
+UDEF bool map_file(const char *path, Mapped_File *mf);
+UDEF void unmap_file(Mapped_File *mf);
+
+// Reads a whole stream that cannot be mapped (stdin) into sb, READ_CHUNK bytes per fread
+#ifndef READ_CHUNK
+#define READ_CHUNK (1024*1024)
+#endif
+UDEF bool read_stream(FILE *in, String_Builder *sb);
+
+// mf_to_sv() enables you to just view a Mapped_File as String_View
+#define mf_to_sv(mf) sv_from_parts((mf).data, (mf).count)
+
+// Bump allocator: memory is handed out from big blocks and only released all at once.
+// Pointers stay valid until arena_free(), blocks are never moved.
+#ifndef ARENA_BLOCK_CAP
+#define ARENA_BLOCK_CAP (16*1024)
+#endif
+
+typedef struct Arena_Block Arena_Block;
+struct Arena_Block {
+    Arena_Block *next;
+    size_t count;
+    size_t capacity;
+    char data[];
+};
+
+typedef struct {
+    Arena_Block *head;
+} Arena;
+
+UDEF void *arena_alloc(Arena *a, size_t size);
+UDEF void arena_free(Arena *a);
+
+// Output file written through a large buffer: one fwrite per WRITER_CAP bytes
+#ifndef WRITER_CAP
+#define WRITER_CAP (256*1024)
+#endif
+
+typedef struct {
+    FILE *out;
+    char *items;
+    size_t count;
+    bool failed; // a flush or a direct write came up short, reported by writer_close()
+    bool owned;  // closed by writer_close(), false for stdout
+} Writer;
+
+UDEF bool writer_open(Writer *w, const char *path, bool binary);
+// Writer over an already open stream (stdout): writer_close() flushes it but does not close it
+UDEF bool writer_open_stream(Writer *w, FILE *out, bool binary);
+UDEF void writer_write(Writer *w, const void *data, size_t size);
+UDEF bool writer_flush(Writer *w);
+UDEF bool writer_close(Writer *w);
+
+// Minimal threads: pthreads on POSIX, Win32 threads on Windows
+#ifdef _WIN32
+typedef HANDLE Thread;
+#else
+typedef pthread_t Thread;
+#endif
+
+typedef void (*Thread_Fn)(void *arg);
+
+UDEF bool thread_start(Thread *th, Thread_Fn fn, void *arg);
+UDEF void thread_join(Thread th);
+UDEF int cpu_count(void);
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION Mutex;
+#else
+typedef pthread_mutex_t Mutex;
+#endif
+
+UDEF void mutex_init(Mutex *m);
+UDEF void mutex_lock(Mutex *m);
+UDEF void mutex_unlock(Mutex *m);
+UDEF void mutex_destroy(Mutex *m);
+
+// Monotonic clock, in seconds
+UDEF double now_seconds(void);
+
+typedef struct {
+    char **items;
+    size_t count;
+    size_t capacity;
+} Paths;
+
+UDEF bool is_directory(const char *path);
+// path with its extension (from the last '.' of the file name) replaced by ext, malloc'ed
+UDEF char *replace_extension(const char *path, const char *ext);
+// Appends (malloc'ed) the paths of the regular files of dirpath that end with ext
+UDEF bool dir_files(const char *dirpath, const char *ext, Paths *paths);
+UDEF void free_paths(Paths *paths);
+
+#endif // UTILS_H_
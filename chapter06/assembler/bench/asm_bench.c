@@ -0,0 +1,245 @@
+/*
+   Throughput benchmark of the two-pass assembler: lines per second, peak RSS and probe statistics
+   of the symbol table for each phase, build_symtable() (pass 1) and assembler() (pass 2).
+
+   The suite runs over ASM_Files/Pong.asm and over synthetic programs of 10k, 100k, 1M and 10M
+   lines written by a deterministic generator (same seed, same file), so two builds can be compared
+   run against run. Generated files and their .hack go to the work directory and are removed.
+
+   Build (from chapter06/assembler):
+       gcc -O2 -I. bench/asm_bench.c Parser.c Cleaner.c Code.c SymbolTable.c Utils.c -o asm_bench
+   Run:
+       ./asm_bench [-l labels%] [-v variables%] [-r repetitions] [-w workdir] [-n lines]... [file.asm]...
+       ./asm_bench -g lines [-l labels%] [-v variables%] out.asm     (only write a synthetic program)
+
+   -l: percentage of lines that declare a label (default 5)
+   -v: percentage of lines that load a variable (default 10); every variable is used ~4 times
+   -n: sizes of the synthetic programs (default 10000 100000 1000000 10000000)
+   The best of the repetitions is reported (default 3). Peak RSS is only measured on Linux, where
+   the high-water mark is reset before each phase.
+*/
+
+#include "Parser.h"
+
+// ---------------------------------------------------------------------------------------
+// Generator
+
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+static const char *comps[] = {
+    "D=M", "D=A", "M=D", "M=M+1", "AM=M-1", "D=D+M", "D=D-A", "M=D|M", "A=M", "MD=M-1", "D=!D", "M=0",
+};
+
+// Writes lines lines of valid Hack assembly with the given densities (in percent) to path
+static bool generate(const char *path, size_t lines, int label_pct, int var_pct) {
+    Writer out;
+    if (!writer_open(&out, path, false)) { perror("Error opening file (output)"); return false; }
+    rng_state = 0x2545F4914F6CDD1DULL;
+
+    size_t labels = lines * label_pct / 100;
+    size_t variables = lines * var_pct / 400 + 1;
+    size_t next_label = 0;
+    char line[64];
+    for (size_t i = 0; i < lines; ++i) {
+        uint32_t r = rng() % 100;
+        int n;
+        if (r < (uint32_t)label_pct && next_label < labels) {
+            n = snprintf(line, sizeof(line), "(L%zu)\n", next_label++);
+        } else if (r < (uint32_t)(label_pct + var_pct)) {
+            n = snprintf(line, sizeof(line), "    @v%u\n", (unsigned)(rng() % variables));
+        } else if (r < 60 && labels > 0 && i + 1 < lines) {
+            // jump to any label, backward or forward, with a comment now and then
+            n = snprintf(line, sizeof(line), "    @L%u\n    D;JNE%s\n", (unsigned)(rng() % labels),
+                         rng() % 8 == 0 ? " // loop" : "");
+            ++i;
+        } else if (r < 75) {
+            n = snprintf(line, sizeof(line), "    @%u\n", (unsigned)(rng() % 32768));
+        } else {
+            n = snprintf(line, sizeof(line), "    %s\n", comps[rng() % (sizeof(comps) / sizeof(comps[0]))]);
+        }
+        writer_write(&out, line, (size_t)n);
+    }
+    // labels the random draws did not reach, so that every @L exists
+    while (next_label < labels) {
+        int n = snprintf(line, sizeof(line), "(L%zu)\n", next_label++);
+        writer_write(&out, line, (size_t)n);
+    }
+
+    if (!writer_close(&out)) { perror("Error writing file (output)"); return false; }
+    return true;
+}
+
+// ---------------------------------------------------------------------------------------
+// Measurements
+
+// Resets the peak resident set size of the process, so the next peak_rss_kb() covers one phase only
+static void reset_peak_rss(void) {
+#ifdef __linux__
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if (f) { fputs("5", f); fclose(f); }
+#endif
+}
+
+// Peak resident set size in KB since the last reset_peak_rss(), 0 when unknown
+static size_t peak_rss_kb(void) {
+    size_t kb = 0;
+#ifdef __linux__
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return 0;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "VmHWM: %zu kB", &kb) == 1) break;
+    }
+    fclose(f);
+#endif
+    return kb;
+}
+
+typedef struct {
+    double seconds;
+    size_t rss_kb;
+    Probe_Stats probes;
+} Phase;
+
+static size_t count_lines(const char *path) {
+    Mapped_File f;
+    if (!map_file(path, &f)) return 0;
+    size_t lines = 0;
+    for (const char *p = f.data; (p = memchr(p, '\n', f.data + f.count - p)) != NULL; ++p) lines++;
+    if (f.count > 0 && f.data[f.count - 1] != '\n') lines++;
+    unmap_file(&f);
+    return lines;
+}
+
+static void print_phase(const char *name, size_t lines, const Phase *p) {
+    double avg = p->probes.count ? (double)p->probes.total_probes / p->probes.count : 0;
+    printf("    %-14s %9.3f ms %12.0f lines/s %9zu KB peak   %6zu/%-6zu symbols  probes avg %.2f max %zu\n",
+           name, p->seconds * 1e3, lines / p->seconds, p->rss_kb, p->probes.count, p->probes.capacity,
+           avg, p->probes.max_probe);
+}
+
+// Benchmarks path, a file of the work directory; name is what the report calls it
+static bool bench_file(const char *path, const char *name, int reps) {
+    size_t lines = count_lines(path);
+    if (lines == 0) { fprintf(stderr, "Error reading %s\n", path); return false; }
+
+    Phase pass1 = {0}, pass2 = {0};
+    for (int r = 0; r < reps; ++r) {
+        HashTable *t = create_table();
+        if (!t) return false;
+
+        reset_peak_rss();
+        double start = now_seconds();
+        if (build_symtable(t, path) < 0) { free_table(t); return false; }
+        double s1 = now_seconds() - start;
+        size_t rss1 = peak_rss_kb();
+        Probe_Stats probes1 = probe_stats(t);
+
+        reset_peak_rss();
+        start = now_seconds();
+        if (assembler(t, path, OUTPUT_HACK) < 0) { free_table(t); return false; }
+        double s2 = now_seconds() - start;
+        size_t rss2 = peak_rss_kb();
+        Probe_Stats probes2 = probe_stats(t);
+        free_table(t);
+
+        if (r == 0 || s1 < pass1.seconds) pass1 = (Phase){s1, rss1, probes1};
+        if (r == 0 || s2 < pass2.seconds) pass2 = (Phase){s2, rss2, probes2};
+    }
+
+    printf("%s: %zu lines\n", name, lines);
+    print_phase("build_symtable", lines, &pass1);
+    print_phase("assembler", lines, &pass2);
+    Phase total = {pass1.seconds + pass2.seconds, pass1.rss_kb > pass2.rss_kb ? pass1.rss_kb : pass2.rss_kb, pass2.probes};
+    print_phase("total", lines, &total);
+    return true;
+}
+
+// The assembler writes the .hack next to its input: real programs are copied to the work directory
+static bool copy_file(const char *from, const char *to) {
+    Mapped_File f;
+    if (!map_file(from, &f)) { perror("Error opening file (input)"); return false; }
+    Writer out;
+    bool ok = writer_open(&out, to, true);
+    if (ok) {
+        writer_write(&out, f.data, f.count);
+        ok = writer_close(&out);
+    }
+    if (!ok) perror("Error writing file (output)");
+    unmap_file(&f);
+    return ok;
+}
+
+// Runs the benchmark over a file of the work directory, then removes it and its .hack
+static bool bench_and_remove(const char *path, const char *name, int reps) {
+    bool ok = bench_file(path, name, reps);
+    char *hack = output_name(path, ".hack");
+    remove(path);
+    if (hack) remove(hack);
+    free(hack);
+    return ok;
+}
+
+typedef struct {
+    size_t *items;
+    size_t count;
+    size_t capacity;
+} Sizes;
+
+int main(int argc, char *argv[]) {
+    int label_pct = 5, var_pct = 10, reps = 3;
+    size_t gen_lines = 0;
+    const char *workdir = ".";
+    Sizes sizes = {0};
+    Paths files = {0};
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) label_pct = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) var_pct = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) workdir = argv[++i];
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) da_append(&sizes, (size_t)atoll(argv[++i]));
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) gen_lines = (size_t)atoll(argv[++i]);
+        else da_append(&files, argv[i]);
+    }
+    if (label_pct < 0 || var_pct < 0 || label_pct + var_pct > 50 || reps < 1) {
+        fprintf(stderr, "labels%% + variables%% must be at most 50, repetitions at least 1\n");
+        return EXIT_FAILURE;
+    }
+
+    if (gen_lines) {
+        if (files.count != 1) { fprintf(stderr, "-g needs exactly one output file\n"); return EXIT_FAILURE; }
+        return generate(files.items[0], gen_lines, label_pct, var_pct) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (sizes.count == 0 && files.count == 0) {
+        static const size_t default_sizes[] = { 10000, 100000, 1000000, 10000000 };
+        da_append_many(&sizes, default_sizes, 4);
+        da_append(&files, "ASM_Files/Pong.asm");
+    }
+
+    printf("labels %d%%, variables %d%%, best of %d\n", label_pct, var_pct, reps);
+    int failed = 0;
+    char path[1024];
+    da_foreach(char *, file, &files) {
+        snprintf(path, sizeof(path), "%s/bench_file.asm", workdir);
+        if (!copy_file(*file, path) || !bench_and_remove(path, *file, reps)) failed++;
+    }
+    da_foreach(size_t, n, &sizes) {
+        char name[64];
+        snprintf(name, sizeof(name), "synthetic %zu", *n);
+        snprintf(path, sizeof(path), "%s/bench_%zu.asm", workdir, *n);
+        if (!generate(path, *n, label_pct, var_pct) || !bench_and_remove(path, name, reps)) failed++;
+    }
+
+    da_free(sizes);
+    da_free(files);
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
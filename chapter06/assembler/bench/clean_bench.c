@@ -0,0 +1,107 @@
+/*
+   Microbenchmark of the line cleaning of the assembler front end: bytes of source cleaned per second
+   by the remove_whitespace() + remove_comment() the assembler used before on every line read with
+   fgets(), and by clean_source_scalar() / clean_source() of Cleaner.c over the whole mapped file.
+
+   Build (from chapter06/assembler):
+       gcc -O2 -I. bench/clean_bench.c Cleaner.c Utils.c -o clean_bench            (SSE2)
+       gcc -O2 -mavx2 -I. bench/clean_bench.c Cleaner.c Utils.c -o clean_bench     (AVX2)
+   Run:
+       ./clean_bench [file.asm] [repetitions]
+*/
+
+#include <time.h>
+
+#include "Cleaner.h"
+
+// ---------------------------------------------------------------------------------------
+// Before: each line is copied into a buffer, compacted byte by byte, then searched for "//"
+
+static void remove_whitespace(char *str) {
+    char *src = str;
+    char *dst = str;
+    while(*src != '\0') {
+        if (!isspace((unsigned char)*src))
+            *dst++ = *src;
+        src++;
+    }
+    *dst = '\0';
+}
+
+static void remove_comment(char *str) {
+    char *p = strstr(str, "//");
+    if (p) *p = '\0';
+}
+
+// Lines as fgets() returned them, without the file I/O
+static size_t legacy_clean(String_View source, String_Builder *out) {
+    char line[256];
+    size_t lines = 0;
+    out->count = 0;
+    while (source.count > 0) {
+        String_View l = sv_chop_by_delim(&source, '\n');
+        size_t n = l.count < sizeof(line) - 1 ? l.count : sizeof(line) - 1;
+        memcpy(line, l.data, n);
+        line[n] = '\0';
+        remove_whitespace(line);
+        remove_comment(line);
+        if (line[0] == '\0') continue;
+        sb_append_buf(out, line, strlen(line));
+        da_append(out, '\n');
+        lines++;
+    }
+    return lines;
+}
+
+// ---------------------------------------------------------------------------------------
+
+static double seconds(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : "ASM_Files/Pong.asm";
+    int reps = argc > 2 ? atoi(argv[2]) : 200;
+
+    Mapped_File f;
+    if (!map_file(path, &f)) return EXIT_FAILURE;
+    String_View source = mf_to_sv(f);
+
+    String_Builder before = {0}, scalar = {0}, simd = {0};
+    size_t lines = 0;
+
+    clock_t start = clock();
+    for (int r = 0; r < reps; ++r) lines = legacy_clean(source, &before);
+    double t_before = seconds(start);
+
+    String_View sv_scalar = {0};
+    start = clock();
+    for (int r = 0; r < reps; ++r) sv_scalar = clean_source_scalar(source, &scalar);
+    double t_scalar = seconds(start);
+
+    String_View sv_simd = {0};
+    start = clock();
+    for (int r = 0; r < reps; ++r) sv_simd = clean_source(source, &simd);
+    double t_simd = seconds(start);
+
+    // only "/ /" differs: the old functions look for "//" after the compaction
+    bool same = sv_eq(sv_scalar, sv_simd) && sv_eq(sb_to_sv(before), sv_simd);
+
+    double mb = (double)source.count * reps / (1024.0 * 1024.0);
+    printf("%zu bytes, %zu instructions x %d repetitions (%s)\n", source.count, lines, reps, path);
+    printf("before (remove_whitespace + remove_comment): %8.3f s  %9.1f MB/s\n", t_before, mb / t_before);
+    printf("after  (clean_source_scalar):                %8.3f s  %9.1f MB/s\n", t_scalar, mb / t_scalar);
+#if defined(__AVX2__)
+    printf("after  (clean_source, AVX2):                 %8.3f s  %9.1f MB/s\n", t_simd, mb / t_simd);
+#else
+    printf("after  (clean_source, SSE2):                 %8.3f s  %9.1f MB/s\n", t_simd, mb / t_simd);
+#endif
+    printf("speedup: %.1fx (scalar %.1fx)%s\n", t_before / t_simd, t_before / t_scalar,
+           same ? "" : "  (WARNING: outputs differ!)");
+
+    sb_free(before);
+    sb_free(scalar);
+    sb_free(simd);
+    unmap_file(&f);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,248 @@
+/*
+   Microbenchmark of the C-instruction decoder: C-instructions decoded per second by the
+   string-returning parser_comp/parser_dest/parser_jump + mnemonic HashTable lookups the
+   assembler used before, and by the allocation-free code_comp/code_dest/code_jump in Code.c.
+
+   Build (from chapter06/assembler):
+       gcc -O2 -I. bench/decode_bench.c Code.c Utils.c -o decode_bench
+   Run:
+       ./decode_bench [file.asm] [repetitions]
+*/
+
+#include <time.h>
+
+#include "Code.h"
+
+// ---------------------------------------------------------------------------------------
+// Before: every field is malloc'ed as a string and then hashed into a 2048-slot table.
+// The table is a private copy of the one SymbolTable.c had then (djb2 hash, strdup'ed keys,
+// one Bucket vector per slot for collisions), so the baseline does not follow later changes
+// of the symbol table. The mnemonic tables never reach the load factor: no rehash.
+
+#define LEGACY_TABLE_SIZE 2048
+
+typedef struct {
+    char *key;
+    int address;
+} Legacy_Entry;
+
+typedef struct {
+    Legacy_Entry *items;
+    size_t count;
+    size_t capacity;
+} Legacy_Bucket;
+
+typedef struct {
+    Legacy_Entry table[LEGACY_TABLE_SIZE];
+    Legacy_Bucket buckets[LEGACY_TABLE_SIZE];
+} Legacy_Table;
+
+static size_t legacy_hash(const char *str) {
+    size_t hash = 5381;
+    for (; *str; ++str) hash = ((hash << 5) + hash) + (unsigned char)*str;
+    return hash;
+}
+
+static char *legacy_strdup(const char *s) {
+    char *r = malloc(strlen(s) + 1);
+    if (r) strcpy(r, s);
+    return r;
+}
+
+static Legacy_Table *legacy_create_table(void) {
+    Legacy_Table *t = calloc(1, sizeof(Legacy_Table));
+    assert(t != NULL && "More RAM!");
+    return t;
+}
+
+static void legacy_add_entry(Legacy_Table *t, const char *key, int address) {
+    size_t i = legacy_hash(key) % LEGACY_TABLE_SIZE;
+    if (t->table[i].key == NULL) {
+        t->table[i] = (Legacy_Entry){legacy_strdup(key), address};
+    } else {
+        da_append(&t->buckets[i], ((Legacy_Entry){legacy_strdup(key), address}));
+    }
+}
+
+static int legacy_get_address(Legacy_Table *t, const char *key) {
+    size_t i = legacy_hash(key) % LEGACY_TABLE_SIZE;
+    if (t->table[i].key == NULL) return -1;
+    if (strcmp(t->table[i].key, key) == 0) return t->table[i].address;
+    da_foreach(Legacy_Entry, e, &t->buckets[i]) {
+        if (strcmp(e->key, key) == 0) return e->address;
+    }
+    return -1;
+}
+
+static void legacy_free_table(Legacy_Table *t) {
+    for (size_t i = 0; i < LEGACY_TABLE_SIZE; ++i) {
+        free(t->table[i].key);
+        da_foreach(Legacy_Entry, e, &t->buckets[i]) free(e->key);
+        da_free(t->buckets[i]);
+    }
+    free(t);
+}
+
+static Legacy_Table *dest_table;
+static Legacy_Table *comp_table;
+static Legacy_Table *jump_table;
+
+static void legacy_create_tables(void) {
+    static const char *dests[] = { "NULL", "M", "D", "MD", "A", "AM", "AD", "AMD" };
+    static const char *jumps[] = { "NULL", "JGT", "JEQ", "JGE", "JLT", "JNE", "JLE", "JMP" };
+
+    dest_table = legacy_create_table();
+    comp_table = legacy_create_table();
+    jump_table = legacy_create_table();
+    for (int i = 0; i < 8; ++i) legacy_add_entry(dest_table, dests[i], i);
+    for (int i = 0; i < 8; ++i) legacy_add_entry(jump_table, jumps[i], i);
+    for (size_t i = 0; i < comp_mnemonics_count; ++i)
+        legacy_add_entry(comp_table, comp_mnemonics[i].mnemonic, comp_mnemonics[i].bits);
+}
+
+static char *legacy_parser_dest(const char *command) {
+    int a = 0, d = 0, m = 0;
+    const char *p = command;
+    while (*p != '\0' && *p != '=') {
+        if (*p == 'A') a = 1;
+        else if (*p == 'D') d = 1;
+        else if (*p == 'M') m = 1;
+        p++;
+    }
+    const char *dests[8] = { "Error", "M", "D", "MD", "A", "AM", "AD", "AMD" };
+    return legacy_strdup((*p == '\0') ? "NULL" : dests[(a << 2) | (d << 1) | m]);
+}
+
+static char *legacy_parser_comp(const char *command) {
+    const char *start = strchr(command, '=');
+    if (start) start++;
+    else start = command;
+
+    const char *end = strchr(start, ';');
+    size_t len = end ? (size_t)(end - start) : strlen(start);
+
+    char *cm = malloc(len + 1);
+    if (!cm) return NULL;
+    strncpy(cm, start, len);
+    cm[len] = '\0';
+
+    for (size_t i = 0; i < comp_mnemonics_count; i++) {
+        if (strcmp(cm, comp_mnemonics[i].mnemonic) == 0) return cm;
+    }
+    free(cm);
+    return legacy_strdup("Error");
+}
+
+static char *legacy_parser_jump(const char *command) {
+    const char *p = strchr(command, ';');
+    if (!p) return legacy_strdup("NULL");
+    p++;
+    for (size_t i = 1; i < jump_mnemonics_count; i++) {
+        if (strcmp(p, jump_mnemonics[i].mnemonic) == 0) return legacy_strdup(jump_mnemonics[i].mnemonic);
+    }
+    return legacy_strdup("Error");
+}
+
+static int legacy_decode(const char *line) {
+    char *c = legacy_parser_comp(line);
+    char *d = legacy_parser_dest(line);
+    char *j = legacy_parser_jump(line);
+    int instruction = (0b111 << 13)
+                    | (legacy_get_address(comp_table, c) << 6)
+                    | (legacy_get_address(dest_table, d) << 3)
+                    | legacy_get_address(jump_table, j);
+    free(c);
+    free(d);
+    free(j);
+    return instruction;
+}
+
+// ---------------------------------------------------------------------------------------
+// After
+
+static int decode(String_View line) {
+    String_View dest = {0};
+    String_View rest = line;
+    if (memchr(line.data, '=', line.count)) dest = sv_chop_by_delim(&rest, '=');
+    String_View comp = sv_chop_by_delim(&rest, ';');
+    return (0b111 << 13) | (code_comp(comp) << 6) | (code_dest(dest) << 3) | code_jump(rest);
+}
+
+// ---------------------------------------------------------------------------------------
+
+typedef struct {
+    String_View *items;
+    size_t count;
+    size_t capacity;
+} Lines;
+
+typedef struct {
+    size_t *items;
+    size_t count;
+    size_t capacity;
+} Offsets;
+
+static double seconds(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : "ASM_Files/Pong.asm";
+    int reps = argc > 2 ? atoi(argv[2]) : 50;
+
+    Mapped_File f;
+    if (!map_file(path, &f)) return EXIT_FAILURE;
+
+    // C-instructions of the file, cleaned and NULL-terminated so both decoders can read them
+    String_Builder text = {0};
+    Offsets offsets = {0};
+    String_View source = mf_to_sv(f);
+    while (source.count > 0) {
+        String_View line = sv_strip_comment(sv_chop_by_delim(&source, '\n'));
+        if (line.count == 0 || line.data[0] == '@' || line.data[0] == '(') continue;
+        da_append(&offsets, text.count);
+        for (size_t i = 0; i < line.count; ++i) {
+            if (!isspace((unsigned char)line.data[i])) da_append(&text, line.data[i]);
+        }
+        da_append(&text, '\0');
+    }
+    Lines lines = {0};
+    da_foreach(size_t, offset, &offsets) da_append(&lines, sv_from_cstr(text.items + *offset));
+    da_free(offsets);
+
+    if (lines.count == 0) {
+        fprintf(stderr, "No C-instruction in %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    legacy_create_tables();
+
+    size_t total = lines.count * (size_t)reps;
+    unsigned checksum_before = 0, checksum_after = 0;
+
+    clock_t start = clock();
+    for (int r = 0; r < reps; ++r) {
+        da_foreach(String_View, line, &lines) checksum_before += legacy_decode(line->data);
+    }
+    double before = seconds(start);
+
+    start = clock();
+    for (int r = 0; r < reps; ++r) {
+        da_foreach(String_View, line, &lines) checksum_after += decode(*line);
+    }
+    double after = seconds(start);
+
+    printf("%zu C-instructions x %d repetitions (%s)\n", lines.count, reps, path);
+    printf("before (strings + HashTable): %8.3f s  %12.0f instructions/s\n", before, total / before);
+    printf("after  (packed switch):       %8.3f s  %12.0f instructions/s\n", after, total / after);
+    printf("speedup: %.1fx%s\n", before / after,
+           checksum_before == checksum_after ? "" : "  (WARNING: decoders disagree!)");
+
+    legacy_free_table(dest_table);
+    legacy_free_table(comp_table);
+    legacy_free_table(jump_table);
+    da_free(lines);
+    sb_free(text);
+    unmap_file(&f);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+/*
+   Microbenchmark of the disassembler: time to build the 65536-entry table once, then time to
+   disassemble a ROM image (with its .sym map when there is one) into memory.
+
+   Build (from chapter06/assembler):
+       gcc -O2 -I. bench/disasm_bench.c Disassembler.c Assembler.c Parser.c Cleaner.c Code.c SymbolTable.c Utils.c -o disasm_bench
+   Run:
+       ./disasm_bench [file.hack] [repetitions]     (default: 100k random words)
+*/
+
+#include <time.h>
+
+#include "Disassembler.h"
+
+static double seconds(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[]) {
+    int reps = argc > 2 ? atoi(argv[2]) : 100;
+
+    Rom rom = {0};
+    Hack_Symbol *symbols = NULL;
+    size_t symbol_count = 0;
+    Arena names = {0};
+    if (argc > 1) {
+        if (read_rom(argv[1], &rom) < 0) return EXIT_FAILURE;
+        char *sym_path = replace_extension(argv[1], ".sym");
+        FILE *sym_file = fopen(sym_path, "rb");
+        if (sym_file) {
+            fclose(sym_file);
+            read_symbol_map(sym_path, &symbols, &symbol_count, &names);
+        }
+        free(sym_path);
+    } else {
+        srand(42);
+        for (int i = 0; i < 100000; ++i) da_append(&rom, (uint16_t)(rand() & 0xFFFF));
+    }
+
+    clock_t start = clock();
+    Disasm_Table *lut = create_disasm_table();
+    double t_table = seconds(start);
+    if (!lut) return EXIT_FAILURE;
+
+    String_Builder text = {0};
+    start = clock();
+    for (int r = 0; r < reps; ++r) {
+        text.count = 0;
+        disassemble(lut, rom.items, rom.count, symbols, symbol_count, &text);
+    }
+    double t = seconds(start) / reps;
+
+    printf("%zu words, %zu symbols (%s)\n", rom.count, symbol_count, argc > 1 ? argv[1] : "random");
+    printf("table:       %8.3f ms (once)\n", t_table * 1e3);
+    printf("disassemble: %8.3f ms  %12.0f words/s  %zu bytes of assembly\n", t * 1e3, rom.count / t, text.count);
+
+    sb_free(text);
+    free_disasm_table(lut);
+    free(symbols);
+    arena_free(&names);
+    da_free(rom);
+    return EXIT_SUCCESS;
+}
@@ -1,42 +1,189 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-#include "Code.h"
-#include "Parser.h"
+#include "Batch.h"
+#include "Optimizer.h"
+#include "Disassembler.h"
+
+static void usage(const char *program) {
+    fprintf(stderr, "Uso: %s [-s | -j threads | -O passes [-E]] [-f hack|bin|hex] [-m] <arquivo.asm>\n", program);
+    fprintf(stderr, "     %s [-s] [-f hack|bin|hex] -    (stdin -> stdout)\n", program);
+    fprintf(stderr, "     %s -d <arquivo.hack|.bin|.hex>\n", program);
+    fprintf(stderr, "     %s -b [-j workers] [-f hack|bin|hex] [-m] <diretorio | arquivo.asm | lista>...\n", program);
+    fprintf(stderr, "    -s    single pass: read the file once and backpatch forward references\n");
+    fprintf(stderr, "    -j    split the file in chunks assembled in parallel (0: one thread per core)\n");
+    fprintf(stderr, "    -f    output format: .hack text (default), .bin packed 16-bit words (little-endian)\n");
+    fprintf(stderr, "          or .hex with 4 hexadecimal digits per word\n");
+    fprintf(stderr, "    -O    optimize the assembly before encoding it: comma separated passes or \"all\"\n");
+    fprintf(stderr, "          pushpop: push immediately popped into D\n");
+    fprintf(stderr, "          jumps:   jumps threaded to their final target, jumps to the next instruction removed\n");
+    fprintf(stderr, "          areg:    @X dropped when A already holds X\n");
+    fprintf(stderr, "          dce:     label regions unreachable from address 0 dropped, with a ROM budget report\n");
+    fprintf(stderr, "    -E    with -O, also write the optimized assembly as .opt.asm\n");
+    fprintf(stderr, "    -m    also write the .sym map: labels with their ROM address, variables with their RAM address\n");
+    fprintf(stderr, "    -     read the assembly from stdin and write the ROM to stdout\n");
+    fprintf(stderr, "    -d    disassemble a ROM image into .dis.asm, with the label names of its .sym if present\n");
+    fprintf(stderr, "    -b    batch: assemble every .asm of the directories, the files given and the files\n");
+    fprintf(stderr, "          listed (one path per line) in the other arguments with a pool of workers\n");
+}
+
+// Expands an argument of the batch mode into .asm paths
+static bool collect_inputs(const char *arg, Paths *paths) {
+    if (is_directory(arg)) return dir_files(arg, ".asm", paths);
+
+    size_t n = strlen(arg);
+    if (n >= 4 && strcmp(arg + n - 4, ".asm") == 0) {
+        da_append(paths, strdup(arg));
+        return true;
+    }
+
+    // anything else is a list of files
+    Mapped_File f;
+    if (!map_file(arg, &f)) return false;
+    String_View list = mf_to_sv(f);
+    while (list.count > 0) {
+        String_View line = sv_trim(sv_chop_by_delim(&list, '\n'));
+        if (line.count == 0) continue;
+        char *path = malloc(line.count + 1);
+        assert(path != NULL && "More RAM!");
+        memcpy(path, line.data, line.count);
+        path[line.count] = '\0';
+        da_append(paths, path);
+    }
+    unmap_file(&f);
+    return true;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// A file named twice (in a directory and in a list, say) would be assembled by two workers
+// writing the same output: sort the paths and keep one of each
+static void unique_inputs(Paths *paths) {
+    if (paths->count == 0) return;
+    qsort(paths->items, paths->count, sizeof(*paths->items), compare_paths);
+    size_t kept = 1;
+    for (size_t i = 1; i < paths->count; ++i) {
+        if (strcmp(paths->items[i], paths->items[kept - 1]) == 0) free(paths->items[i]);
+        else paths->items[kept++] = paths->items[i];
+    }
+    paths->count = kept;
+}
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Uso: %s <arquivo.asm>\n", argv[0]);
+    int single_pass = 0;
+    int batch = 0;
+    int disasm = 0;
+    int symbols = 0;
+    unsigned passes = 0;
+    int emit = 0;
+    int threads = 1;
+    int threads_set = 0;
+    Output_Format format = OUTPUT_HACK;
+    const char *path = NULL;
+    Paths inputs = {0};
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-s") == 0) single_pass = 1;
+        else if (strcmp(argv[i], "-b") == 0) batch = 1;
+        else if (strcmp(argv[i], "-d") == 0) disasm = 1;
+        else if (strcmp(argv[i], "-m") == 0) symbols = 1;
+        else if (strcmp(argv[i], "-E") == 0) emit = 1;
+        else if (strcmp(argv[i], "-O") == 0 && i + 1 < argc) {
+            passes = opt_parse_passes(argv[++i]);
+            if (!passes) { usage(argv[0]); return EXIT_FAILURE; }
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) { threads = atoi(argv[++i]); threads_set = 1; }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            if (strcmp(name, "hack") == 0) format = OUTPUT_HACK;
+            else if (strcmp(name, "bin") == 0) format = OUTPUT_BIN;
+            else if (strcmp(name, "hex") == 0) format = OUTPUT_HEX;
+            else { usage(argv[0]); return EXIT_FAILURE; }
+        }
+        else if (batch) {
+            if (!collect_inputs(argv[i], &inputs)) { free_paths(&inputs); return EXIT_FAILURE; }
+        }
+        else if (!path) path = argv[i];
+        else { usage(argv[0]); return EXIT_FAILURE; }
+    }
+
+    if (batch) {
+        if (single_pass || passes || disasm || path || inputs.count == 0) {
+            usage(argv[0]);
+            free_paths(&inputs);
+            return EXIT_FAILURE;
+        }
+        unique_inputs(&inputs);
+        int failed = assemble_batch(inputs.items, inputs.count, format, threads_set ? threads : 0, symbols);
+        free_paths(&inputs);
+        return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    // -s, -j, -O and -d pick how the file is processed: only one of them
+    int modes = single_pass + (passes != 0) + threads_set + disasm;
+    if (!path || (emit && !passes) || modes > 1 || (disasm && symbols)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int stream = strcmp(path, "-") == 0;
+    if (stream && (passes || symbols || disasm || threads_set)) {
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
 
-    const char *path = argv[1];
+    if (disasm) {
+        if (disassembler(path) < 0) {
+            fprintf(stderr, "Failed to disassemble %s.", path);
+            return EXIT_FAILURE;
+        }
+        printf("Disassembling finished successfully!\n");
+        return EXIT_SUCCESS;
+    }
+
     HashTable *t = create_table();
     if (!t) {
         perror("Error creating Symbol Table.");
         return EXIT_FAILURE;
     }
 
-    if (build_symtable(t, path) < 0) {
+    if (stream) {
+        int rc = assembler_stream(t, stdin, stdout, format, single_pass);
+        free_table(t);
+        if (rc < 0) {
+            fprintf(stderr, "Failed to translate ASM code to binary.");
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    int parallel = !single_pass && !passes && threads != 1;
+    if (!single_pass && !parallel && !passes && build_symtable(t, path) < 0) {
         fprintf(stderr, "Error building the symbol table during the first pass.");
         free_table(t);
         return EXIT_FAILURE;
     }
 
-    if (create_mnemonic_tables() < 0) {
-        perror("Error creating Mnemonic Tables.");
+    int rc;
+    if (passes) rc = assembler_optimized(t, path, format, passes, emit);
+    else if (single_pass) rc = assembler_single_pass(t, path, format);
+    else if (parallel) rc = assembler_parallel(t, path, format, threads);
+    else rc = assembler(t, path, format);
+    if (rc < 0) {
+        fprintf(stderr, "Failed to translate ASM code to binary.");
+        free_table(t);
         return EXIT_FAILURE;
     }
 
-    if (assembler(t, path) < 0) {
-        fprintf(stderr, "Failed to translate ASM code to binary.");
-        free_mnemonic_tables();
+    if (symbols && write_symbol_map(t, path) < 0) {
+        fprintf(stderr, "Failed to write the symbol map.");
         free_table(t);
         return EXIT_FAILURE;
     }
 
     printf("Assembling finished successfully!\n");
-    free_mnemonic_tables();
     free_table(t);
 
     return EXIT_SUCCESS;
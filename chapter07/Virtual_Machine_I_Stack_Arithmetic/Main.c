@@ -1,13 +1,24 @@
 #include "Writer.h"
 
+static void usage(const char *program) {
+    fprintf(stderr, "Use: %s [-r] <\\directory\n", program);
+    fprintf(stderr, "    -r    eq, gt and lt jump to one shared routine each instead of being inlined\n");
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Use: %s <\\directory\n", argv[0]);
+    Code_Options options = {0};
+    const char *dir_path = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0) options.shared_compares = true;
+        else if (!dir_path) dir_path = argv[i];
+        else { usage(argv[0]); return EXIT_FAILURE; }
+    }
+    if (!dir_path) {
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
 
-    const char *dir_path = argv[1];
-
     char output_path[MAX_PATH];
     if (snprintf(output_path, sizeof(output_path), "%s\\output.asm", dir_path) >= sizeof(output_path)) {
         fprintf(stderr, "Output path too long\n");
@@ -15,7 +26,7 @@ int main(int argc, char *argv[]) {
     }
 
     Code_Writer code_writer;
-    if(!code_writer_init(&code_writer, output_path)) {
+    if(!code_writer_init(&code_writer, output_path, options)) {
         fprintf(stderr, "Erro %d: %s\n", errno, strerror(errno));
         code_writer_close(&code_writer);
         return EXIT_FAILURE;
@@ -52,25 +63,15 @@ int main(int argc, char *argv[]) {
 
         parser_active = true;
 
-        while (has_more_commands(&parser)) {
-            advance(&parser);
-            Command_Type type = command_type(&parser);
-
-            switch (type)
-            {
-            case C_ARITHMETIC:
-                write_arithmetic(&code_writer, arg1(&parser));
-                break;
-            
-            case C_PUSH:
-            case C_POP:
-                write_push_pop(&code_writer, type, arg1(&parser), arg2(&parser));
-                break;
-            
-            default:
-                break;
-            }
+        Vm_Program program = {0};
+        if (!parse_program(&parser, &program)) {
+            fprintf(stderr, "parser failed for %s\n", path);
+            vm_program_free(&program);
+            status = EXIT_FAILURE;
+            goto cleanup;
         }
+        write_program(&code_writer, &program);
+        vm_program_free(&program);
 
         parser_free(&parser);
         parser_active = false;
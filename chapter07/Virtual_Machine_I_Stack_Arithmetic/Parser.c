@@ -1,97 +1,198 @@
 #include "Parser.h"
 
-static inline Command_Type parser_command_type(String_View cmd) {
-    if (sv_eq(cmd, sv_from_cstr("push")))     return C_PUSH;
-    if (sv_eq(cmd, sv_from_cstr("pop")))      return C_POP;
-    if (sv_eq(cmd, sv_from_cstr("label")))    return C_LABEL;
-    if (sv_eq(cmd, sv_from_cstr("goto")))     return C_GOTO;
-    if (sv_eq(cmd, sv_from_cstr("if-goto")))  return C_IF;
-    if (sv_eq(cmd, sv_from_cstr("function"))) return C_FUNCTION;
-    if (sv_eq(cmd, sv_from_cstr("return")))   return C_RETURN;
-    if (sv_eq(cmd, sv_from_cstr("call")))     return C_CALL;
-
-    return C_ARITHMETIC;
+static inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
 }
 
-static inline String_View parser_arg1(Command_Type type, Words ws) {
-    if (type == C_RETURN) {
-        fprintf(stderr, "arg1 called on C_RETURN!\n");
-        exit(1);
+// Splits a cleared line into the token slots, without allocating
+static void tokenize(String_View line, Tokens *ws) {
+    const char *p = line.data;
+    const char *end = line.data + line.count;
+    ws->count = 0;
+    while (p < end) {
+        while (p < end && is_blank(*p)) p++;
+        if (p == end) break;
+        const char *start = p;
+        while (p < end && !is_blank(*p)) p++;
+        if (ws->count < VM_MAX_TOKENS) ws->items[ws->count] = sv_from_parts(start, p - start);
+        ws->count++;
     }
-    if (type == C_ARITHMETIC) return ws.items[0];
-    return ws.items[1];
 }
 
-static inline int16_t parser_arg2(Command_Type type, Words ws) {
-    if (!(type == C_PUSH || type == C_POP ||
-          type == C_FUNCTION || type == C_CALL)) {
-        fprintf(stderr, "arg2 called on invalid command type!\n");
-        exit(1);
-    }
+// Moves to the next line that holds a command and keeps it in p->next. Each byte is looked at
+// once: the same loop finds the end of the line and the start of the comment.
+static void find_next(Parser *p) {
+    const char *s = p->content.data;
+    const char *end = s + p->content.count;
+    while (s < end) {
+        const char *line_end = s;
+        const char *cut = NULL;
+        while (line_end < end && *line_end != '\n') {
+            if (*line_end == '/' && !cut && line_end + 1 < end && line_end[1] == '/') cut = line_end;
+            line_end++;
+        }
 
-    return sv_to_i16(ws.items[2]);
+        const char *first = s;
+        const char *last = cut ? cut : line_end;
+        s = line_end < end ? line_end + 1 : end;
+        while (first < last && is_blank(*first)) first++;
+        while (last > first && is_blank(last[-1])) last--;
+        if (first < last) {
+            p->next = sv_from_parts(first, last - first);
+            p->content = sv_from_parts(s, end - s);
+            return;
+        }
+    }
+    p->next = (String_View){0};
+    p->content = sv_from_parts(end, 0);
 }
 
 bool parser_init(Parser *p, const char *path) {
-    p->data = (String_Builder){0};
-    if (!read_entire_file(path, &p->data)) {
+    if (!map_file(path, &p->file)) {
         errno = EIO;
         return false;
     }
 
-    p->content = sb_to_sv(p->data);
+    p->content = mf_to_sv(p->file);
     p->current = (String_View){0};
-    p->ws = (Words){0};
+    p->ws = (Tokens){0};
+    find_next(p);
     return true;
 }
 
 bool has_more_commands(Parser *p) {
-    String_View tmp = p->content;
-    while (tmp.count > 0) {
-        String_View line = sv_chop_by_delim(&tmp, '\n');
-        line = sv_strip_comment(line);
-        line = sv_trim(line);
-        if (line.count > 0) {
-            return true; // has at least 1 valid line
-        }
-    }
-    return false;
+    return p->next.count > 0;
 }
 
 void advance(Parser *p) {
-    // release previous tokens
-    da_free(p->ws);
+    p->current = p->next;
+    tokenize(p->current, &p->ws);
+    find_next(p);
+}
 
-    while (p->content.count > 0) {
-        String_View line = sv_chop_by_delim(&p->content, '\n');
-        line = sv_strip_comment(line);
-        line = sv_trim(line);
+void parser_free(Parser *p) {
+    unmap_file(&p->file);
+}
 
-        if (line.count > 0) {
-            p->current = line;
-            p->ws = words(line);
-            return;
-        }
+// ---------------------------------------------------------------------------------------
+// Typed instructions
+
+const char *vm_op_names[VM_OP_COUNT] = {
+    [VM_ADD] = "add", [VM_SUB] = "sub", [VM_NEG] = "neg",
+    [VM_EQ]  = "eq",  [VM_GT]  = "gt",  [VM_LT]  = "lt",
+    [VM_AND] = "and", [VM_OR]  = "or",  [VM_NOT] = "not",
+    [VM_PUSH] = "push", [VM_POP] = "pop",
+    [VM_LABEL] = "label", [VM_GOTO] = "goto", [VM_IF] = "if-goto",
+    [VM_FUNCTION] = "function", [VM_CALL] = "call", [VM_RETURN] = "return",
+};
+
+const char *vm_segment_names[SEG_COUNT] = {
+    [SEG_ARGUMENT] = "argument", [SEG_LOCAL] = "local", [SEG_STATIC]  = "static", [SEG_CONSTANT] = "constant",
+    [SEG_THIS]     = "this",     [SEG_THAT]  = "that",  [SEG_POINTER] = "pointer", [SEG_TEMP]    = "temp",
+};
+
+static int lookup_name(const char **names, int count, String_View sv) {
+    for (int i = 0; i < count; ++i) {
+        if (names[i][0] == sv.data[0] && strncmp(names[i], sv.data, sv.count) == 0 && names[i][sv.count] == '\0') return i;
     }
+    return -1;
+}
 
-    p->current = (String_View){0};
+static uint32_t hash_sv(String_View sv) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < sv.count; ++i) {
+        h ^= (unsigned char)sv.data[i];
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15); // the low bits pick the slot: fold the high ones in
 }
 
-Command_Type command_type(Parser *p) {
-    return parser_command_type(p->ws.items[0]);
+static void names_grow(Vm_Names *names) {
+    size_t slot_count = names->slot_count ? names->slot_count * 2 : 256;
+    uint32_t *slots = calloc(slot_count, sizeof(*slots));
+    assert(slots != NULL && "More RAM!");
+    for (size_t id = 0; id < names->count; ++id) {
+        size_t i = hash_sv(names->items[id]) & (slot_count - 1);
+        while (slots[i]) i = (i + 1) & (slot_count - 1);
+        slots[i] = (uint32_t)id + 1;
+    }
+    free(names->slots);
+    names->slots = slots;
+    names->slot_count = slot_count;
 }
 
-String_View arg1(Parser *p) {
-    Command_Type type = command_type(p);
-    return parser_arg1(type, p->ws);
+uint32_t vm_intern(Vm_Names *names, String_View name) {
+    if ((names->count + 1) * 2 > names->slot_count) names_grow(names);
+
+    size_t i = hash_sv(name) & (names->slot_count - 1);
+    while (names->slots[i]) {
+        uint32_t id = names->slots[i] - 1;
+        if (sv_eq(names->items[id], name)) return id;
+        i = (i + 1) & (names->slot_count - 1);
+    }
+    uint32_t id = (uint32_t)names->count;
+    da_append(names, name);
+    names->slots[i] = id + 1;
+    return id;
 }
 
-int16_t arg2(Parser *p) {
-    Command_Type type = command_type(p);
-    return parser_arg2(type, p->ws);
+static bool parse_index(String_View sv, uint16_t *index) {
+    int16_t n = sv_to_i16(sv);
+    if (n < 0) return false;
+    *index = (uint16_t)n;
+    return true;
 }
 
-void parser_free(Parser *p) {
-    da_free(p->ws);
-    sb_free(p->data);
-}
\ No newline at end of file
+bool parse_program(Parser *p, Vm_Program *prog) {
+    while (has_more_commands(p)) {
+        advance(p);
+        const Tokens *ws = &p->ws;
+        Vm_Instruction ins = {0};
+        bool ok = false;
+
+        int op = lookup_name(vm_op_names, VM_OP_COUNT, ws->items[0]);
+        ins.op = (uint8_t)op;
+        switch (op) {
+        case VM_PUSH:
+        case VM_POP: {
+            int segment = ws->count == 3 ? lookup_name(vm_segment_names, SEG_COUNT, ws->items[1]) : -1;
+            ins.segment = (uint8_t)segment;
+            ok = segment >= 0 && !(op == VM_POP && segment == SEG_CONSTANT) && parse_index(ws->items[2], &ins.index);
+        } break;
+
+        case VM_LABEL:
+        case VM_GOTO:
+        case VM_IF:
+            ok = ws->count == 2;
+            if (ok) ins.name = vm_intern(&prog->names, ws->items[1]);
+            break;
+
+        case VM_FUNCTION:
+        case VM_CALL:
+            ok = ws->count == 3 && parse_index(ws->items[2], &ins.index);
+            if (ok) ins.name = vm_intern(&prog->names, ws->items[1]);
+            break;
+
+        case -1:
+            break;
+
+        default: // arithmetic and return
+            ok = ws->count == 1;
+            break;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "invalid VM command: " SV_Fmt "\n", SV_Arg(p->current));
+            return false;
+        }
+        da_append(prog, ins);
+    }
+    return true;
+}
+
+void vm_program_free(Vm_Program *prog) {
+    da_free(prog->names);
+    free(prog->names.slots);
+    da_free(*prog);
+    *prog = (Vm_Program){0};
+}
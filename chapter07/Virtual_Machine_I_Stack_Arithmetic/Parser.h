@@ -3,23 +3,22 @@
 
 #include "Utils.h"
 
-typedef enum {
-    C_ARITHMETIC,
-    C_PUSH,
-    C_POP,
-    C_LABEL,
-    C_GOTO,
-    C_IF,
-    C_FUNCTION,
-    C_RETURN,
-    C_CALL
-} Command_Type;
+// Tokens of a command: a VM command has at most 3 words. count keeps counting past the
+// slots, so a line with extra words is still seen as malformed.
+#define VM_MAX_TOKENS 3
+
+typedef struct {
+    String_View items[VM_MAX_TOKENS];
+    size_t count;
+} Tokens;
 
+// Walks the mapped file forward only: every line is chopped and tokenized once
 typedef struct {
-    String_Builder data;   // allocated data (owner)
-    String_View content;   // non-owning view into the buffer owned by String_Builder
+    Mapped_File file;
+    String_View content;   // rest of the file after the next command
     String_View current;   // current command (line already cleared)
-    Words       ws;        // tokens of the current line
+    String_View next;      // next command, empty at the end of the file
+    Tokens      ws;        // tokens of the current line
 } Parser;
 
 // Initialize the parser with the contents of a .vm file
@@ -31,16 +30,60 @@ bool has_more_commands(Parser *p);
 // Advance to the next command
 void advance(Parser *p);
 
-// What is the type of the current command
-Command_Type command_type(Parser *p);
+// Frees resources
+void parser_free(Parser *p);
+
+// ---------------------------------------------------------------------------------------
+// Typed instructions: every .vm file is parsed once into an array that the code writer walks
 
-// First argument
-String_View arg1(Parser *p);
+typedef enum {
+    VM_ADD, VM_SUB, VM_NEG, VM_EQ, VM_GT, VM_LT, VM_AND, VM_OR, VM_NOT,
+    VM_PUSH, VM_POP,
+    VM_LABEL, VM_GOTO, VM_IF,
+    VM_FUNCTION, VM_CALL, VM_RETURN,
+    VM_OP_COUNT
+} Vm_Op;
 
-// Second argument
-int16_t arg2(Parser *p);
+typedef enum {
+    SEG_ARGUMENT, SEG_LOCAL, SEG_STATIC, SEG_CONSTANT, SEG_THIS, SEG_THAT, SEG_POINTER, SEG_TEMP,
+    SEG_COUNT
+} Vm_Segment;
 
-// Frees resources
-void parser_free(Parser *p);
+// 8 bytes per command
+typedef struct {
+    uint8_t  op;       // Vm_Op
+    uint8_t  segment;  // Vm_Segment (push/pop)
+    uint16_t index;    // push/pop: index, function: number of locals, call: number of arguments
+    uint32_t name;     // label, goto, if-goto, function, call: id in Vm_Program.names
+} Vm_Instruction;
+
+// Interned label and function names: the same name always gets the same id
+typedef struct {
+    String_View *items;  // id -> name (views into the parsed file)
+    size_t count;
+    size_t capacity;
+    uint32_t *slots;     // open addressing over the ids: id + 1, 0 = empty
+    size_t slot_count;   // power of two
+} Vm_Names;
+
+typedef struct {
+    Vm_Instruction *items;
+    size_t count;
+    size_t capacity;
+    Vm_Names names;
+} Vm_Program;
+
+// Names of the commands and segments as written in a .vm file
+extern const char *vm_op_names[VM_OP_COUNT];
+extern const char *vm_segment_names[SEG_COUNT];
+
+// Appends the commands of p to prog. The names point into the file of p: the parser must
+// outlive the program. Reports the command and returns false if it is malformed.
+bool parse_program(Parser *p, Vm_Program *prog);
+
+uint32_t vm_intern(Vm_Names *names, String_View name);
+#define vm_name(prog, id) ((prog)->names.items[(id)])
+
+void vm_program_free(Vm_Program *prog);
 
 #endif // PARSER_H_
\ No newline at end of file
@@ -35,6 +35,99 @@ defer:
     return result;
 }
 
+UDEF bool map_file(const char *path, Mapped_File *mf) {
+    mf->data = NULL;
+    mf->count = 0;
+
+#ifdef _WIN32
+    mf->file = INVALID_HANDLE_VALUE;
+    mf->mapping = NULL;
+
+    mf->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mf->file == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "ERROR: Could not open file %s: %lu\n", path, GetLastError());
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mf->file, &size)) {
+        fprintf(stderr, "ERROR: Could not get size of file %s: %lu\n", path, GetLastError());
+        unmap_file(mf);
+        return false;
+    }
+
+    // an empty file cannot be mapped, it is just an empty view
+    if (size.QuadPart == 0) {
+        mf->data = "";
+        return true;
+    }
+
+    mf->mapping = CreateFileMappingA(mf->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mf->mapping == NULL) {
+        fprintf(stderr, "ERROR: Could not map file %s: %lu\n", path, GetLastError());
+        unmap_file(mf);
+        return false;
+    }
+
+    mf->data = MapViewOfFile(mf->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (mf->data == NULL) {
+        fprintf(stderr, "ERROR: Could not map file %s: %lu\n", path, GetLastError());
+        unmap_file(mf);
+        return false;
+    }
+    mf->count = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: Could not open file %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "ERROR: Could not get size of file %s: %s\n", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    // an empty file cannot be mapped, it is just an empty view
+    if (st.st_size == 0) {
+        close(fd);
+        mf->data = "";
+        return true;
+    }
+
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "ERROR: Could not map file %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    // the parser reads each .vm file once, front to back
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mf->data = p;
+    mf->count = (size_t)st.st_size;
+#endif
+
+    return true;
+}
+
+UDEF void unmap_file(Mapped_File *mf) {
+#ifdef _WIN32
+    if (mf->count > 0 && mf->data) UnmapViewOfFile(mf->data);
+    if (mf->mapping) CloseHandle(mf->mapping);
+    if (mf->file != INVALID_HANDLE_VALUE) CloseHandle(mf->file);
+    mf->mapping = NULL;
+    mf->file = INVALID_HANDLE_VALUE;
+#else
+    if (mf->count > 0) munmap((void *)mf->data, mf->count);
+#endif
+    mf->data = NULL;
+    mf->count = 0;
+}
+
 UDEF void sv_print(String_View sv) {
     printf(SV_Fmt, SV_Arg(sv));
 }
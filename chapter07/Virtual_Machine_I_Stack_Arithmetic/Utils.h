@@ -41,6 +41,8 @@
 #    include <sys/stat.h>
 #    include <unistd.h>
 #    include <fcntl.h>
+#    include <dirent.h>
+#    include <sys/mman.h>
 #endif
 
 #ifdef _WIN32
@@ -175,6 +177,22 @@ typedef struct {
     const char *data;
 } String_View;
 
+// Read-only view of a whole file mapped into memory
+typedef struct {
+    const char *data;
+    size_t count;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} Mapped_File;
+
+UDEF bool map_file(const char *path, Mapped_File *mf);
+UDEF void unmap_file(Mapped_File *mf);
+
+// mf_to_sv() enables you to just view a Mapped_File as String_View
+#define mf_to_sv(mf) sv_from_parts((mf).data, (mf).count)
+
 UDEF void sv_print(String_View sv);
 UDEF void sv_println(String_View sv);
 
@@ -18,11 +18,13 @@ static inline void write_end(Code_Writer *cw) {
     );
 }
 
-bool code_writer_init(Code_Writer *cw, const char *output_path) {
+bool code_writer_init(Code_Writer *cw, const char *output_path, Code_Options options) {
     cw->out = fopen(output_path, "w");
     if (!cw->out) return false;
     
     write_init(cw);
+    cw->options = options;
+    cw->compares_used = 0;
     cw->label_counter = 0;
     cw->file_name[0] = '\0';
     return true;
@@ -39,110 +41,118 @@ void set_file_name(Code_Writer *cw, const char *file_path) {
     if (dot) *dot = '\0';
 }
 
-// true: -1 | false: 0
-void write_arithmetic(Code_Writer *cw, String_View command) {
-    if (sv_eq(command, sv_from_cstr("add"))) {
-        fprintf(cw->out,
-            "@SP\n"
-            "AM=M-1\n"     // SP--; D = *SP
-            "D=M\n"
-            "A=A-1\n"      // A = SP-1
-            "M=D+M\n"      // *SP = *SP + D
-        );
-    } else if (sv_eq(command, sv_from_cstr("sub"))) {
-        fprintf(cw->out,
-            "@SP\n"
-            "AM=M-1\n"   // SP--; A=SP
-            "D=M\n"      // D = y
-            "A=A-1\n"    // A = SP-1 (x)
-            "D=M-D\n"    // D = x - y
-            "M=D\n"      // *SP = x - y
-        );
-    } else if (sv_eq(command, sv_from_cstr("neg"))) {
-        fprintf(cw->out,
-            "@SP\n"
-            "A=M-1\n"
-            "M=-M\n"
-        );
-    } else if (sv_eq(command, sv_from_cstr("eq"))) {
-        int id = cw->label_counter++;
-        char true_label[32], end_label[32];
-        snprintf(true_label, sizeof(true_label), "EQ_TRUE_%d", id);
-        snprintf(end_label, sizeof(end_label), "EQ_END_%d", id);
+// eq, gt, lt: x - y tested with jump (true: -1 | false: 0), indexed by op - VM_EQ
+static const struct {
+    const char *name;
+    const char *jump;
+} compares[] = {
+    { "EQ", "JEQ" },
+    { "GT", "JGT" },
+    { "LT", "JLT" },
+};
+
+static void write_compare(Code_Writer *cw, Vm_Op op) {
+    const char *name = compares[op - VM_EQ].name;
+    const char *jump = compares[op - VM_EQ].jump;
+    int id = cw->label_counter++;
 
+    if (cw->options.shared_compares) {
+        cw->compares_used |= 1u << (op - VM_EQ);
         fprintf(cw->out,
-            "@SP\n"
-            "AM=M-1\n"       // SP--; A=SP
-            "D=M\n"          // D = y
-            "A=A-1\n"        // A = SP-1
-            "D=M-D\n"        // D = x - y
-            "@%s\n"
-            "D;JEQ\n"        // if x==y, jump to EQ_TRUE_N
-            "@SP\n"
-            "A=M-1\n"
-            "M=0\n"          // false
-            "@%s\n"
+            "@%s_RET_%d\n"
+            "D=A\n"          // D = return address
+            "@$%s\n"
             "0;JMP\n"
-            "(%s)\n"
-            "@SP\n"
-            "A=M-1\n"
-            "M=-1\n"         // true
-            "(%s)\n",
-            true_label, end_label, true_label, end_label
+            "(%s_RET_%d)\n",
+            name, id, name, name, id
         );
-    } else if (sv_eq(command, sv_from_cstr("gt"))) {
-        int id = cw->label_counter++;
-        char true_label[32], end_label[32];
-        snprintf(true_label, sizeof(true_label), "GT_TRUE_%d", id);
-        snprintf(end_label, sizeof(end_label), "GT_END_%d", id);
+        return;
+    }
+
+    fprintf(cw->out,
+        "@SP\n"
+        "AM=M-1\n"       // SP--; A=SP
+        "D=M\n"          // D = y
+        "A=A-1\n"        // A = SP-1
+        "D=M-D\n"        // D = x - y
+        "@%s_TRUE_%d\n"
+        "D;%s\n"         // if x op y, jump to <NAME>_TRUE_N
+        "@SP\n"
+        "A=M-1\n"
+        "M=0\n"          // false
+        "@%s_END_%d\n"
+        "0;JMP\n"
+        "(%s_TRUE_%d)\n"
+        "@SP\n"
+        "A=M-1\n"
+        "M=-1\n"         // true
+        "(%s_END_%d)\n",
+        name, id, jump, name, id, name, id, name, id
+    );
+}
 
+// $EQ, $GT, $LT: D = return address, kept in R15
+static void write_compare_routines(Code_Writer *cw) {
+    for (int i = 0; i < 3; ++i) {
+        if (!(cw->compares_used & (1u << i))) continue;
         fprintf(cw->out,
+            "\n($%s)\n"
+            "@R15\n"
+            "M=D\n"
             "@SP\n"
-            "AM=M-1\n"       // SP--; A=SP
+            "AM=M-1\n"
             "D=M\n"          // D = y
-            "A=A-1\n"        // A = SP-1
+            "A=A-1\n"
             "D=M-D\n"        // D = x - y
-            "@%s\n"
-            "D;JGT\n"        // if x > y, jump to GT_TRUE_N
+            "M=-1\n"         // true
+            "@$%s_END\n"
+            "D;%s\n"
             "@SP\n"
             "A=M-1\n"
             "M=0\n"          // false
-            "@%s\n"
-            "0;JMP\n"
-            "(%s)\n"
-            "@SP\n"
-            "A=M-1\n"
-            "M=-1\n"         // true
-            "(%s)\n",
-            true_label, end_label, true_label, end_label
+            "($%s_END)\n"
+            "@R15\n"
+            "A=M\n"
+            "0;JMP",
+            compares[i].name, compares[i].name, compares[i].jump, compares[i].name
         );
-    } else if (sv_eq(command, sv_from_cstr("lt"))) {
-        int id = cw->label_counter++;
-        char true_label[32], end_label[32];
-        snprintf(true_label, sizeof(true_label), "LT_TRUE_%d", id);
-        snprintf(end_label, sizeof(end_label), "LT_END_%d", id);
+    }
+}
 
+void write_arithmetic(Code_Writer *cw, Vm_Op op) {
+    switch (op) {
+    case VM_ADD:
         fprintf(cw->out,
             "@SP\n"
-            "AM=M-1\n"       // SP--; A=SP
-            "D=M\n"          // D = y
-            "A=A-1\n"        // A = SP-1
-            "D=M-D\n"        // D = x - y
-            "@%s\n"
-            "D;JLT\n"        // if x < y, jump to LT_TRUE_N
+            "AM=M-1\n"     // SP--; D = *SP
+            "D=M\n"
+            "A=A-1\n"      // A = SP-1
+            "M=D+M\n"      // *SP = *SP + D
+        );
+        break;
+    case VM_SUB:
+        fprintf(cw->out,
             "@SP\n"
-            "A=M-1\n"
-            "M=0\n"          // false
-            "@%s\n"
-            "0;JMP\n"
-            "(%s)\n"
+            "AM=M-1\n"   // SP--; A=SP
+            "D=M\n"      // D = y
+            "A=A-1\n"    // A = SP-1 (x)
+            "D=M-D\n"    // D = x - y
+            "M=D\n"      // *SP = x - y
+        );
+        break;
+    case VM_NEG:
+        fprintf(cw->out,
             "@SP\n"
             "A=M-1\n"
-            "M=-1\n"         // true
-            "(%s)\n",
-            true_label, end_label, true_label, end_label
+            "M=-M\n"
         );
-    } else if (sv_eq(command, sv_from_cstr("and"))) {
+        break;
+    case VM_EQ:
+    case VM_GT:
+    case VM_LT:
+        write_compare(cw, op);
+        break;
+    case VM_AND:
         fprintf(cw->out,
             "@SP\n"
             "AM=M-1\n"   // SP--; A=SP
@@ -150,7 +160,8 @@ void write_arithmetic(Code_Writer *cw, String_View command) {
             "A=A-1\n"    // A = SP-1
             "M=D&M\n"    // *SP = x & y
         );
-    } else if (sv_eq(command, sv_from_cstr("or"))) {
+        break;
+    case VM_OR:
         fprintf(cw->out,
             "@SP\n"
             "AM=M-1\n"   // SP--; A=SP
@@ -158,18 +169,28 @@ void write_arithmetic(Code_Writer *cw, String_View command) {
             "A=A-1\n"    // A = SP-1
             "M=D|M\n"    // *SP = x | y
         );
-    } else if (sv_eq(command, sv_from_cstr("not"))) {
+        break;
+    case VM_NOT:
         fprintf(cw->out,
             "@SP\n"
             "A=M-1\n"   // A = top of the stack
             "M=!M\n"    // *SP = ~(*SP)
         );
+        break;
+    default:
+        break;
     }
 }
 
-void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment, int index) {
-    if (command == C_PUSH) {
-        if (sv_eq(segment, sv_from_cstr("constant"))) {
+// Base pointer of the segments addressed through RAM[base] + index
+static const char *segment_base[SEG_COUNT] = {
+    [SEG_LOCAL] = "LCL", [SEG_ARGUMENT] = "ARG", [SEG_THIS] = "THIS", [SEG_THAT] = "THAT",
+};
+
+void write_push_pop(Code_Writer *cw, Vm_Op command, Vm_Segment segment, int index) {
+    if (command == VM_PUSH) {
+        switch (segment) {
+        case SEG_CONSTANT:
             // push constant i
             fprintf(cw->out,
                 "@%d\n"
@@ -181,51 +202,13 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=M+1\n",
                 index
             );
-        } else if (sv_eq(segment, sv_from_cstr("local"))) {
-            fprintf(cw->out,
-                "@LCL\n"
-                "D=M\n"
-                "@%d\n"
-                "A=D+A\n"
-                "D=M\n"
-                "@SP\n"
-                "A=M\n"
-                "M=D\n"
-                "@SP\n"
-                "M=M+1\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("argument"))) {
-            fprintf(cw->out,
-                "@ARG\n"
-                "D=M\n"
-                "@%d\n"
-                "A=D+A\n"
-                "D=M\n"
-                "@SP\n"
-                "A=M\n"
-                "M=D\n"
-                "@SP\n"
-                "M=M+1\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("this"))) {
-            fprintf(cw->out,
-                "@THIS\n"
-                "D=M\n"
-                "@%d\n"
-                "A=D+A\n"
-                "D=M\n"
-                "@SP\n"
-                "A=M\n"
-                "M=D\n"
-                "@SP\n"
-                "M=M+1\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("that"))) {
+            break;
+        case SEG_LOCAL:
+        case SEG_ARGUMENT:
+        case SEG_THIS:
+        case SEG_THAT:
             fprintf(cw->out,
-                "@THAT\n"
+                "@%s\n"
                 "D=M\n"
                 "@%d\n"
                 "A=D+A\n"
@@ -235,9 +218,10 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=D\n"
                 "@SP\n"
                 "M=M+1\n",
-                index
+                segment_base[segment], index
             );
-        } else if (sv_eq(segment, sv_from_cstr("static"))) {
+            break;
+        case SEG_STATIC:
             fprintf(cw->out,
                 "@%s.%d\n"
                 "D=M\n"
@@ -248,7 +232,8 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=M+1\n",
                 cw->file_name, index
             );
-        } else if (sv_eq(segment, sv_from_cstr("temp"))) {
+            break;
+        case SEG_TEMP:
             fprintf(cw->out,
                 "@R%d\n"
                 "D=M\n"
@@ -259,7 +244,8 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=M+1\n",
                 5 + index
             );
-        } else if (sv_eq(segment, sv_from_cstr("pointer"))) {
+            break;
+        case SEG_POINTER:
             // pointer 0 = THIS, pointer 1 = THAT
             fprintf(cw->out,
                 "@%s\n"
@@ -271,73 +257,33 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=M+1\n",
                 index == 0 ? "THIS" : "THAT"
             );
+            break;
+        default:
+            break;
         }
-    } else if (command == C_POP) {
-        if (sv_eq(segment, sv_from_cstr("local"))) {
-            fprintf(cw->out,
-                "@LCL\n"
-                "D=M\n"
-                "@%d\n"
-                "D=D+A\n"
-                "@R13\n"
-                "M=D\n"        // R13 = LCL + index
-                "@SP\n"
-                "AM=M-1\n"
-                "D=M\n"
-                "@R13\n"
-                "A=M\n"
-                "M=D\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("argument"))) {
-            fprintf(cw->out,
-                "@ARG\n"
-                "D=M\n"
-                "@%d\n"
-                "D=D+A\n"
-                "@R13\n"
-                "M=D\n"
-                "@SP\n"
-                "AM=M-1\n"
-                "D=M\n"
-                "@R13\n"
-                "A=M\n"
-                "M=D\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("this"))) {
-            fprintf(cw->out,
-                "@THIS\n"
-                "D=M\n"
-                "@%d\n"
-                "D=D+A\n"
-                "@R13\n"
-                "M=D\n"
-                "@SP\n"
-                "AM=M-1\n"
-                "D=M\n"
-                "@R13\n"
-                "A=M\n"
-                "M=D\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("that"))) {
+    } else if (command == VM_POP) {
+        switch (segment) {
+        case SEG_LOCAL:
+        case SEG_ARGUMENT:
+        case SEG_THIS:
+        case SEG_THAT:
             fprintf(cw->out,
-                "@THAT\n"
+                "@%s\n"
                 "D=M\n"
                 "@%d\n"
                 "D=D+A\n"
                 "@R13\n"
-                "M=D\n"
+                "M=D\n"        // R13 = base + index
                 "@SP\n"
                 "AM=M-1\n"
                 "D=M\n"
                 "@R13\n"
                 "A=M\n"
                 "M=D\n",
-                index
+                segment_base[segment], index
             );
-        } else if (sv_eq(segment, sv_from_cstr("static"))) {
+            break;
+        case SEG_STATIC:
             fprintf(cw->out,
                 "@SP\n"
                 "AM=M-1\n"
@@ -346,7 +292,8 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=D\n",
                 cw->file_name, index
             );
-        } else if (sv_eq(segment, sv_from_cstr("temp"))) {
+            break;
+        case SEG_TEMP:
             fprintf(cw->out,
                 "@SP\n"
                 "AM=M-1\n"
@@ -355,7 +302,8 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=D\n",
                 5 + index
             );
-        } else if (sv_eq(segment, sv_from_cstr("pointer"))) {
+            break;
+        case SEG_POINTER:
             fprintf(cw->out,
                 "@SP\n"
                 "AM=M-1\n"
@@ -364,11 +312,38 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=D\n",
                 index == 0 ? "THIS" : "THAT"
             );
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// Writes the code of every command of a parsed file: this translator handles the stack
+// arithmetic and memory access commands only, the program flow commands are skipped
+void write_program(Code_Writer *cw, const Vm_Program *prog) {
+    da_foreach(const Vm_Instruction, ins, prog) {
+        switch (ins->op) {
+        case VM_PUSH:
+        case VM_POP:
+            write_push_pop(cw, ins->op, ins->segment, ins->index);
+            break;
+        case VM_LABEL:
+        case VM_GOTO:
+        case VM_IF:
+        case VM_FUNCTION:
+        case VM_CALL:
+        case VM_RETURN:
+            break;
+        default:
+            write_arithmetic(cw, ins->op);
+            break;
         }
     }
 }
 
 void code_writer_close(Code_Writer *cw) {
     write_end(cw);
+    write_compare_routines(cw);
     if (cw->out) fclose(cw->out);
 }
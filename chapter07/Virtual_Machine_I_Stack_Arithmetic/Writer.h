@@ -3,27 +3,36 @@
 
 #include "Parser.h"
 
+typedef struct {
+    bool shared_compares;      // eq/gt/lt jump to the shared $EQ/$GT/$LT routines
+} Code_Options;
+
 typedef struct {
     FILE *out;                 // .asm output
+    Code_Options options;
+    unsigned compares_used;    // bit per comparison routine to write at the end (eq, gt, lt)
     char file_name[MAX_PATH];  // base name of the current file (.vm)
     int label_counter;         // counter to generate unique labels (e.g. eq_true1, eq_true2)
 } Code_Writer;
 
 // Initialize and open the output file (.asm)
-bool code_writer_init(Code_Writer *cw, const char *output_path);
+bool code_writer_init(Code_Writer *cw, const char *output_path, Code_Options options);
 
 // Informs that it has started translating a new VM file
 void set_file_name(Code_Writer *cw, const char *file_name);
 
 // Write code for arithmetic commands (add, sub, neg, eq, gt, lt, and, or, not)
-void write_arithmetic(Code_Writer *cw, String_View command);
+void write_arithmetic(Code_Writer *cw, Vm_Op op);
 
 // Write code for push/pop
 void write_push_pop(Code_Writer *cw,
-                    Command_Type command,
-                    String_View segment,
+                    Vm_Op command,
+                    Vm_Segment segment,
                     int index);
 
+// Writes the code of every command of a parsed file
+void write_program(Code_Writer *cw, const Vm_Program *prog);
+
 // Close the output file
 void code_writer_close(Code_Writer *cw);
 
@@ -4,9 +4,92 @@ static inline bool in_function(const Code_Writer *cw) {
     return cw->current_function[0] != '\0';
 }
 
-bool code_writer_init(Code_Writer *cw, const char *out_path, bool with_bootstrap) {
+// ---------------------------------------------------------------------------------------
+// Top of stack cached in D (-t): while tos_cached is set the top value lives only in D and
+// SP does not count it. It is written back before labels, jumps, calls and returns, so every
+// block starts and ends with the whole stack in RAM.
+//
+// Deferred SP (-p): pushes and pops only move sp_offset, the stack is addressed as SP+k and
+// RAM[SP] is written once when the block ends (sync_stack) or the offset grows too far.
+
+// Largest |sp_offset| kept pending: stack slots are reached by walking A, never through D
+#define SP_DEFER_MAX 2
+
+// A = RAM[SP] + k, D untouched
+static void stack_address(Code_Writer *cw, int k) {
+    if (k == 0) {
+        fprintf(cw->out, "@SP\nA=M\n");
+        return;
+    }
+    fprintf(cw->out, "@SP\nA=M%s\n", k > 0 ? "+1" : "-1");
+    for (int i = 1; i < abs(k); ++i) fprintf(cw->out, "A=A%s\n", k > 0 ? "+1" : "-1");
+}
+
+// Writes the pending offset back to RAM[SP], D untouched
+static void write_sp(Code_Writer *cw) {
+    if (cw->sp_offset == 0) return;
+    fprintf(cw->out, "@SP\n");
+    for (int i = 0; i < abs(cw->sp_offset); ++i) fprintf(cw->out, "M=M%s\n", cw->sp_offset > 0 ? "+1" : "-1");
+    cw->sp_offset = 0;
+}
+
+static void spill(Code_Writer *cw) {
+    if (!cw->tos_cached) return;
+    if (cw->options.defer_sp) {
+        stack_address(cw, cw->sp_offset++);
+        fprintf(cw->out, "M=D\n");
+    } else {
+        fprintf(cw->out,
+            "@SP\n"
+            "M=M+1\n"
+            "A=M-1\n"
+            "M=D\n"
+        );
+    }
+    cw->tos_cached = false;
+}
+
+static void fill(Code_Writer *cw) {
+    if (cw->tos_cached) return;
+    if (cw->options.defer_sp) {
+        stack_address(cw, --cw->sp_offset);
+        fprintf(cw->out, "D=M\n");
+    } else {
+        fprintf(cw->out,
+            "@SP\n"
+            "AM=M-1\n"
+            "D=M\n"
+        );
+    }
+    cw->tos_cached = true;
+}
+
+// Whole stack in RAM and RAM[SP] up to date: where control flow joins or leaves the block
+static void sync_stack(Code_Writer *cw) {
+    if (cw->options.defer_sp && cw->tos_cached) {
+        // SP moved past the cached value first, then D stored below it: one @SP for both
+        cw->sp_offset++;
+        fprintf(cw->out, "@SP\n");
+        for (int i = 0; i < abs(cw->sp_offset); ++i) fprintf(cw->out, "M=M%s\n", cw->sp_offset > 0 ? "+1" : "-1");
+        fprintf(cw->out, "A=M-1\nM=D\n");
+        cw->sp_offset = 0;
+        cw->tos_cached = false;
+        return;
+    }
+    spill(cw);
+    write_sp(cw);
+}
+
+bool code_writer_init(Code_Writer *cw, const char *out_path, bool with_bootstrap, Code_Options options) {
     cw->out = fopen(out_path, "w");
     if (!cw->out) return false;
+    cw->options = options;
+    cw->uses_call = false;
+    cw->uses_return = false;
+    cw->compares_used = 0;
+    cw->tos_cached = false;
+    cw->sp_offset = 0;
+    memset(cw->fused, 0, sizeof(cw->fused));
     cw->label_counter = 0;
     cw->file_name[0]        = '\0';
     cw->current_function[0] = '\0';
@@ -32,6 +115,7 @@ bool code_writer_init(Code_Writer *cw, const char *out_path, bool with_bootstrap
 }
 
 void set_file_name(Code_Writer *cw, const char *file_path) {
+    spill(cw); // static names change with the file
     const char *b1 = strrchr(file_path, '/');
     const char *b2 = strrchr(file_path, '\\');
     const char *base = b1 > b2 ? b1 : b2;
@@ -42,110 +126,297 @@ void set_file_name(Code_Writer *cw, const char *file_path) {
     if (dot) *dot = '\0';
 }
 
-// true: -1 | false: 0
-void write_arithmetic(Code_Writer *cw, String_View command) {
-    if (sv_eq(command, sv_from_cstr("add"))) {
-        fprintf(cw->out,
-            "@SP\n"
-            "AM=M-1\n"     // SP--; D = *SP
-            "D=M\n"
-            "A=A-1\n"      // A = SP-1
-            "M=D+M\n"      // *SP = *SP + D
-        );
-    } else if (sv_eq(command, sv_from_cstr("sub"))) {
-        fprintf(cw->out,
-            "@SP\n"
-            "AM=M-1\n"   // SP--; A=SP
-            "D=M\n"      // D = y
-            "A=A-1\n"    // A = SP-1 (x)
-            "D=M-D\n"    // D = x - y
-            "M=D\n"      // *SP = x - y
-        );
-    } else if (sv_eq(command, sv_from_cstr("neg"))) {
+// eq, gt, lt: x - y tested with jump (true: -1 | false: 0), indexed by op - VM_EQ
+static const struct {
+    const char *name;
+    const char *jump;
+    const char *not_jump; // jump of the negated comparison
+} compares[] = {
+    { "EQ", "JEQ", "JNE" },
+    { "GT", "JGT", "JLE" },
+    { "LT", "JLT", "JGE" },
+};
+
+static void write_compare(Code_Writer *cw, Vm_Op op) {
+    const char *name = compares[op - VM_EQ].name;
+    const char *jump = compares[op - VM_EQ].jump;
+    int id = cw->label_counter++;
+
+    if (cw->options.shared_compares) {
+        cw->compares_used |= 1u << (op - VM_EQ);
         fprintf(cw->out,
-            "@SP\n"
-            "A=M-1\n"
-            "M=-M\n"
+            "@%s_RET_%d\n"
+            "D=A\n"          // D = return address
+            "@$%s\n"
+            "0;JMP\n"
+            "(%s_RET_%d)\n",
+            name, id, name, name, id
         );
-    } else if (sv_eq(command, sv_from_cstr("eq"))) {
-        int id = cw->label_counter++;
-        char true_label[32], end_label[32];
-        snprintf(true_label, sizeof(true_label), "EQ_TRUE_%d", id);
-        snprintf(end_label, sizeof(end_label), "EQ_END_%d", id);
+        return;
+    }
 
+    fprintf(cw->out,
+        "@SP\n"
+        "AM=M-1\n"       // SP--; A=SP
+        "D=M\n"          // D = y
+        "A=A-1\n"        // A = SP-1
+        "D=M-D\n"        // D = x - y
+        "@%s_TRUE_%d\n"
+        "D;%s\n"         // if x op y, jump to <NAME>_TRUE_N
+        "@SP\n"
+        "A=M-1\n"
+        "M=0\n"          // false
+        "@%s_END_%d\n"
+        "0;JMP\n"
+        "(%s_TRUE_%d)\n"
+        "@SP\n"
+        "A=M-1\n"
+        "M=-1\n"         // true
+        "(%s_END_%d)\n",
+        name, id, jump, name, id, name, id, name, id
+    );
+}
+
+// $EQ, $GT, $LT: D = return address, kept in R15
+static void write_compare_routines(Code_Writer *cw) {
+    for (int i = 0; i < 3; ++i) {
+        if (!(cw->compares_used & (1u << i))) continue;
         fprintf(cw->out,
+            "\n($%s)\n"
+            "@R15\n"
+            "M=D\n"
             "@SP\n"
-            "AM=M-1\n"       // SP--; A=SP
+            "AM=M-1\n"
             "D=M\n"          // D = y
-            "A=A-1\n"        // A = SP-1
+            "A=A-1\n"
             "D=M-D\n"        // D = x - y
-            "@%s\n"
-            "D;JEQ\n"        // if x==y, jump to EQ_TRUE_N
+            "M=-1\n"         // true
+            "@$%s_END\n"
+            "D;%s\n"
             "@SP\n"
             "A=M-1\n"
             "M=0\n"          // false
-            "@%s\n"
-            "0;JMP\n"
-            "(%s)\n"
-            "@SP\n"
-            "A=M-1\n"
-            "M=-1\n"         // true
-            "(%s)\n",
-            true_label, end_label, true_label, end_label
+            "($%s_END)\n"
+            "@R15\n"
+            "A=M\n"
+            "0;JMP",
+            compares[i].name, compares[i].name, compares[i].jump, compares[i].name
         );
-    } else if (sv_eq(command, sv_from_cstr("gt"))) {
-        int id = cw->label_counter++;
-        char true_label[32], end_label[32];
-        snprintf(true_label, sizeof(true_label), "GT_TRUE_%d", id);
-        snprintf(end_label, sizeof(end_label), "GT_END_%d", id);
+    }
+}
+
+// Base pointer of the segments addressed through RAM[base] + index
+static const char *segment_base[SEG_COUNT] = {
+    [SEG_LOCAL] = "LCL", [SEG_ARGUMENT] = "ARG", [SEG_THIS] = "THIS", [SEG_THAT] = "THAT",
+};
+
+static void write_arithmetic_cached(Code_Writer *cw, Vm_Op op) {
+    if ((op == VM_NEG || op == VM_NOT) && !cw->tos_cached) {
+        // in place in RAM, as the uncached templates do
+        stack_address(cw, cw->sp_offset - 1);
+        fprintf(cw->out, "%s\n", op == VM_NEG ? "M=-M" : "M=!M");
+        return;
+    }
+    if ((op == VM_EQ || op == VM_GT || op == VM_LT) && cw->options.shared_compares) {
+        // the shared routines work on the stack in RAM
+        sync_stack(cw);
+        write_compare(cw, op);
+        return;
+    }
 
+    fill(cw); // D = y
+    switch (op) {
+    case VM_NEG: fprintf(cw->out, "D=-D\n"); return;
+    case VM_NOT: fprintf(cw->out, "D=!D\n"); return;
+    default: break;
+    }
+
+    // x is the top of the stack in RAM: it is popped and the result stays in D
+    if (cw->options.defer_sp) {
+        stack_address(cw, --cw->sp_offset);
+    } else {
         fprintf(cw->out,
             "@SP\n"
-            "AM=M-1\n"       // SP--; A=SP
-            "D=M\n"          // D = y
-            "A=A-1\n"        // A = SP-1
+            "AM=M-1\n"
+        );
+    }
+    switch (op) {
+    case VM_ADD: fprintf(cw->out, "D=D+M\n"); break;
+    case VM_SUB: fprintf(cw->out, "D=M-D\n"); break;
+    case VM_AND: fprintf(cw->out, "D=D&M\n"); break;
+    case VM_OR:  fprintf(cw->out, "D=D|M\n"); break;
+    case VM_EQ:
+    case VM_GT:
+    case VM_LT: {
+        const char *name = compares[op - VM_EQ].name;
+        int id = cw->label_counter++;
+        fprintf(cw->out,
             "D=M-D\n"        // D = x - y
-            "@%s\n"
-            "D;JGT\n"        // if x > y, jump to GT_TRUE_N
-            "@SP\n"
-            "A=M-1\n"
-            "M=0\n"          // false
-            "@%s\n"
+            "@%s_TRUE_%d\n"
+            "D;%s\n"
+            "D=0\n"          // false
+            "@%s_END_%d\n"
             "0;JMP\n"
-            "(%s)\n"
-            "@SP\n"
-            "A=M-1\n"
-            "M=-1\n"         // true
-            "(%s)\n",
-            true_label, end_label, true_label, end_label
+            "(%s_TRUE_%d)\n"
+            "D=-1\n"         // true
+            "(%s_END_%d)\n",
+            name, id, compares[op - VM_EQ].jump, name, id, name, id, name, id
         );
-    } else if (sv_eq(command, sv_from_cstr("lt"))) {
-        int id = cw->label_counter++;
-        char true_label[32], end_label[32];
-        snprintf(true_label, sizeof(true_label), "LT_TRUE_%d", id);
-        snprintf(end_label, sizeof(end_label), "LT_END_%d", id);
+    } break;
+    default: break;
+    }
+}
+
+// D = value of segment[index]
+static void load_d(Code_Writer *cw, Vm_Segment segment, int index) {
+    switch (segment) {
+    case SEG_CONSTANT:
+        fprintf(cw->out, "@%d\nD=A\n", index);
+        break;
+    case SEG_LOCAL:
+    case SEG_ARGUMENT:
+    case SEG_THIS:
+    case SEG_THAT:
+        if (index == 0) fprintf(cw->out, "@%s\nA=M\nD=M\n", segment_base[segment]);
+        else fprintf(cw->out, "@%s\nD=M\n@%d\nA=D+A\nD=M\n", segment_base[segment], index);
+        break;
+    case SEG_STATIC:
+        fprintf(cw->out, "@%s.%d\nD=M\n", cw->file_name, index);
+        break;
+    case SEG_TEMP:
+        fprintf(cw->out, "@R%d\nD=M\n", 5 + index);
+        break;
+    case SEG_POINTER:
+        fprintf(cw->out, "@%s\nD=M\n", index == 0 ? "THIS" : "THAT");
+        break;
+    default:
+        break;
+    }
+}
+
+// Largest index reached by walking A up from the base pointer instead of going through D or R13/R14
+#define POP_WALK_MAX 4
+
+// segment[index] can be addressed without touching D (not constant)
+static bool direct_address(Vm_Segment segment, int index) {
+    return segment_base[segment] == NULL || index <= POP_WALK_MAX;
+}
+
+// A = address of segment[index]; D is only used when !direct_address()
+static void write_address(Code_Writer *cw, Vm_Segment segment, int index) {
+    switch (segment) {
+    case SEG_LOCAL:
+    case SEG_ARGUMENT:
+    case SEG_THIS:
+    case SEG_THAT:
+        if (index > POP_WALK_MAX) {
+            fprintf(cw->out, "@%s\nD=M\n@%d\nA=D+A\n", segment_base[segment], index);
+            break;
+        }
+        fprintf(cw->out, "@%s\nA=M\n", segment_base[segment]);
+        for (int i = 0; i < index; ++i) fprintf(cw->out, "A=A+1\n");
+        break;
+    case SEG_STATIC:
+        fprintf(cw->out, "@%s.%d\n", cw->file_name, index);
+        break;
+    case SEG_TEMP:
+        fprintf(cw->out, "@R%d\n", 5 + index);
+        break;
+    case SEG_POINTER:
+        fprintf(cw->out, "@%s\n", index == 0 ? "THIS" : "THAT");
+        break;
+    default:
+        break;
+    }
+}
+
+// segment[index] = D
+static void store_d(Code_Writer *cw, Vm_Segment segment, int index) {
+    if (direct_address(segment, index)) {
+        write_address(cw, segment, index);
+        fprintf(cw->out, "M=D\n");
+        return;
+    }
+    fprintf(cw->out,
+        "@R13\n"
+        "M=D\n"        // R13 = value
+        "@%s\n"
+        "D=M\n"
+        "@%d\n"
+        "D=D+A\n"
+        "@R14\n"
+        "M=D\n"        // R14 = base + index
+        "@R13\n"
+        "D=M\n"
+        "@R14\n"
+        "A=M\n"
+        "M=D\n",
+        segment_base[segment], index
+    );
+}
+
+static void write_push_cached(Code_Writer *cw, Vm_Segment segment, int index) {
+    spill(cw);
+    load_d(cw, segment, index);
+    cw->tos_cached = true;
+}
+
+static void write_pop_cached(Code_Writer *cw, Vm_Segment segment, int index) {
+    fill(cw);
+    store_d(cw, segment, index);
+    cw->tos_cached = false;
+}
+
+// Register templates: used by -t, and by -p alone with the value spilled after every command
+static bool register_templates(const Code_Writer *cw) {
+    return cw->options.cache_tos || cw->options.defer_sp;
+}
 
+// End of a command of the register templates
+static void end_command(Code_Writer *cw) {
+    if (!cw->options.cache_tos) spill(cw);
+    if (abs(cw->sp_offset) > SP_DEFER_MAX) write_sp(cw);
+}
+
+void write_arithmetic(Code_Writer *cw, Vm_Op op) {
+    if (register_templates(cw)) {
+        write_arithmetic_cached(cw, op);
+        end_command(cw);
+        return;
+    }
+    switch (op) {
+    case VM_ADD:
         fprintf(cw->out,
             "@SP\n"
-            "AM=M-1\n"       // SP--; A=SP
-            "D=M\n"          // D = y
-            "A=A-1\n"        // A = SP-1
-            "D=M-D\n"        // D = x - y
-            "@%s\n"
-            "D;JLT\n"        // if x < y, jump to LT_TRUE_N
+            "AM=M-1\n"     // SP--; D = *SP
+            "D=M\n"
+            "A=A-1\n"      // A = SP-1
+            "M=D+M\n"      // *SP = *SP + D
+        );
+        break;
+    case VM_SUB:
+        fprintf(cw->out,
             "@SP\n"
-            "A=M-1\n"
-            "M=0\n"          // false
-            "@%s\n"
-            "0;JMP\n"
-            "(%s)\n"
+            "AM=M-1\n"   // SP--; A=SP
+            "D=M\n"      // D = y
+            "A=A-1\n"    // A = SP-1 (x)
+            "D=M-D\n"    // D = x - y
+            "M=D\n"      // *SP = x - y
+        );
+        break;
+    case VM_NEG:
+        fprintf(cw->out,
             "@SP\n"
             "A=M-1\n"
-            "M=-1\n"         // true
-            "(%s)\n",
-            true_label, end_label, true_label, end_label
+            "M=-M\n"
         );
-    } else if (sv_eq(command, sv_from_cstr("and"))) {
+        break;
+    case VM_EQ:
+    case VM_GT:
+    case VM_LT:
+        write_compare(cw, op);
+        break;
+    case VM_AND:
         fprintf(cw->out,
             "@SP\n"
             "AM=M-1\n"   // SP--; A=SP
@@ -153,7 +424,8 @@ void write_arithmetic(Code_Writer *cw, String_View command) {
             "A=A-1\n"    // A = SP-1
             "M=D&M\n"    // *SP = x & y
         );
-    } else if (sv_eq(command, sv_from_cstr("or"))) {
+        break;
+    case VM_OR:
         fprintf(cw->out,
             "@SP\n"
             "AM=M-1\n"   // SP--; A=SP
@@ -161,18 +433,29 @@ void write_arithmetic(Code_Writer *cw, String_View command) {
             "A=A-1\n"    // A = SP-1
             "M=D|M\n"    // *SP = x | y
         );
-    } else if (sv_eq(command, sv_from_cstr("not"))) {
+        break;
+    case VM_NOT:
         fprintf(cw->out,
             "@SP\n"
             "A=M-1\n"   // A = top of the stack
             "M=!M\n"    // *SP = ~(*SP)
         );
+        break;
+    default:
+        break;
     }
 }
 
-void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment, int index) {
-    if (command == C_PUSH) {
-        if (sv_eq(segment, sv_from_cstr("constant"))) {
+void write_push_pop(Code_Writer *cw, Vm_Op command, Vm_Segment segment, int index) {
+    if (register_templates(cw)) {
+        if (command == VM_PUSH) write_push_cached(cw, segment, index);
+        else write_pop_cached(cw, segment, index);
+        end_command(cw);
+        return;
+    }
+    if (command == VM_PUSH) {
+        switch (segment) {
+        case SEG_CONSTANT:
             // push constant i
             fprintf(cw->out,
                 "@%d\n"
@@ -184,51 +467,13 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=M+1\n",
                 index
             );
-        } else if (sv_eq(segment, sv_from_cstr("local"))) {
-            fprintf(cw->out,
-                "@LCL\n"
-                "D=M\n"
-                "@%d\n"
-                "A=D+A\n"
-                "D=M\n"
-                "@SP\n"
-                "A=M\n"
-                "M=D\n"
-                "@SP\n"
-                "M=M+1\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("argument"))) {
+            break;
+        case SEG_LOCAL:
+        case SEG_ARGUMENT:
+        case SEG_THIS:
+        case SEG_THAT:
             fprintf(cw->out,
-                "@ARG\n"
-                "D=M\n"
-                "@%d\n"
-                "A=D+A\n"
-                "D=M\n"
-                "@SP\n"
-                "A=M\n"
-                "M=D\n"
-                "@SP\n"
-                "M=M+1\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("this"))) {
-            fprintf(cw->out,
-                "@THIS\n"
-                "D=M\n"
-                "@%d\n"
-                "A=D+A\n"
-                "D=M\n"
-                "@SP\n"
-                "A=M\n"
-                "M=D\n"
-                "@SP\n"
-                "M=M+1\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("that"))) {
-            fprintf(cw->out,
-                "@THAT\n"
+                "@%s\n"
                 "D=M\n"
                 "@%d\n"
                 "A=D+A\n"
@@ -238,9 +483,10 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=D\n"
                 "@SP\n"
                 "M=M+1\n",
-                index
+                segment_base[segment], index
             );
-        } else if (sv_eq(segment, sv_from_cstr("static"))) {
+            break;
+        case SEG_STATIC:
             fprintf(cw->out,
                 "@%s.%d\n"
                 "D=M\n"
@@ -251,7 +497,8 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=M+1\n",
                 cw->file_name, index
             );
-        } else if (sv_eq(segment, sv_from_cstr("temp"))) {
+            break;
+        case SEG_TEMP:
             fprintf(cw->out,
                 "@R%d\n"
                 "D=M\n"
@@ -262,7 +509,8 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=M+1\n",
                 5 + index
             );
-        } else if (sv_eq(segment, sv_from_cstr("pointer"))) {
+            break;
+        case SEG_POINTER:
             // pointer 0 = THIS, pointer 1 = THAT
             fprintf(cw->out,
                 "@%s\n"
@@ -274,73 +522,33 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=M+1\n",
                 index == 0 ? "THIS" : "THAT"
             );
+            break;
+        default:
+            break;
         }
-    } else if (command == C_POP) {
-        if (sv_eq(segment, sv_from_cstr("local"))) {
-            fprintf(cw->out,
-                "@LCL\n"
-                "D=M\n"
-                "@%d\n"
-                "D=D+A\n"
-                "@R13\n"
-                "M=D\n"        // R13 = LCL + index
-                "@SP\n"
-                "AM=M-1\n"
-                "D=M\n"
-                "@R13\n"
-                "A=M\n"
-                "M=D\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("argument"))) {
-            fprintf(cw->out,
-                "@ARG\n"
-                "D=M\n"
-                "@%d\n"
-                "D=D+A\n"
-                "@R13\n"
-                "M=D\n"
-                "@SP\n"
-                "AM=M-1\n"
-                "D=M\n"
-                "@R13\n"
-                "A=M\n"
-                "M=D\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("this"))) {
+    } else if (command == VM_POP) {
+        switch (segment) {
+        case SEG_LOCAL:
+        case SEG_ARGUMENT:
+        case SEG_THIS:
+        case SEG_THAT:
             fprintf(cw->out,
-                "@THIS\n"
-                "D=M\n"
-                "@%d\n"
-                "D=D+A\n"
-                "@R13\n"
-                "M=D\n"
-                "@SP\n"
-                "AM=M-1\n"
-                "D=M\n"
-                "@R13\n"
-                "A=M\n"
-                "M=D\n",
-                index
-            );
-        } else if (sv_eq(segment, sv_from_cstr("that"))) {
-            fprintf(cw->out,
-                "@THAT\n"
+                "@%s\n"
                 "D=M\n"
                 "@%d\n"
                 "D=D+A\n"
                 "@R13\n"
-                "M=D\n"
+                "M=D\n"        // R13 = base + index
                 "@SP\n"
                 "AM=M-1\n"
                 "D=M\n"
                 "@R13\n"
                 "A=M\n"
                 "M=D\n",
-                index
+                segment_base[segment], index
             );
-        } else if (sv_eq(segment, sv_from_cstr("static"))) {
+            break;
+        case SEG_STATIC:
             fprintf(cw->out,
                 "@SP\n"
                 "AM=M-1\n"
@@ -349,7 +557,8 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=D\n",
                 cw->file_name, index
             );
-        } else if (sv_eq(segment, sv_from_cstr("temp"))) {
+            break;
+        case SEG_TEMP:
             fprintf(cw->out,
                 "@SP\n"
                 "AM=M-1\n"
@@ -358,7 +567,8 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=D\n",
                 5 + index
             );
-        } else if (sv_eq(segment, sv_from_cstr("pointer"))) {
+            break;
+        case SEG_POINTER:
             fprintf(cw->out,
                 "@SP\n"
                 "AM=M-1\n"
@@ -367,11 +577,15 @@ void write_push_pop(Code_Writer *cw, Command_Type command, String_View segment,
                 "M=D\n",
                 index == 0 ? "THIS" : "THAT"
             );
+            break;
+        default:
+            break;
         }
     }
 }
 
 void write_label(Code_Writer *cw, String_View label) {
+    sync_stack(cw);
     if (in_function(cw)) {
         fprintf(cw->out, "(%s$%.*s)\n",
                 cw->current_function, (int)label.count, label.data);
@@ -380,36 +594,62 @@ void write_label(Code_Writer *cw, String_View label) {
     }
 }
 
-void write_goto(Code_Writer *cw, String_View label) {
+// @label, qualified with the current function
+static void write_label_ref(Code_Writer *cw, String_View label) {
     if (in_function(cw)) {
-        fprintf(cw->out, "@%s$%.*s\n0;JMP\n",
+        fprintf(cw->out, "@%s$%.*s\n",
                 cw->current_function, (int)label.count, label.data);
     } else {
-        fprintf(cw->out, "@%.*s\n0;JMP\n", (int)label.count, label.data);
+        fprintf(cw->out, "@%.*s\n", (int)label.count, label.data);
     }
 }
 
+void write_goto(Code_Writer *cw, String_View label) {
+    sync_stack(cw);
+    write_label_ref(cw, label);
+    fprintf(cw->out, "0;JMP\n");
+}
+
 void write_if(Code_Writer *cw, String_View label) {
-    fprintf(cw->out,
-        "@SP\n"
-        "AM=M-1\n"
-        "D=M\n");
-    if (in_function(cw)) {
-        fprintf(cw->out, "@%s$%.*s\nD;JNE\n",
-                cw->current_function, (int)label.count, label.data);
-    } else {
-        fprintf(cw->out, "@%.*s\nD;JNE\n",
-                (int)label.count, label.data);
-    }
+    fill(cw); // D = condition, from the cache or popped
+    cw->tos_cached = false;
+    write_sp(cw);
+    write_label_ref(cw, label);
+    fprintf(cw->out, "D;JNE\n");
 }
 
 void write_call(Code_Writer *cw, String_View f_name, uint16_t num_args) {
+    sync_stack(cw);
     int id = cw->label_counter++;
 
     char return_label[64];
     snprintf(return_label, sizeof(return_label),
          "RETURN_%.*s_%d", (int)f_name.count, f_name.data, id);
 
+    if (cw->options.calls == CALLS_SIZE) {
+        cw->uses_call = true;
+        fprintf(cw->out,
+            "@%u\n"
+            "D=A\n"
+            "@R13\n"
+            "M=D\n"      // R13 = nArgs
+            "@%.*s\n"
+            "D=A\n"
+            "@R14\n"
+            "M=D\n"      // R14 = f
+            "@%s\n"
+            "D=A\n"      // D = return-address
+            "@$CALL\n"
+            "0;JMP\n"
+            "(%s)\n",
+            num_args,
+            (int)f_name.count, f_name.data,
+            return_label,
+            return_label
+        );
+        return;
+    }
+
     fprintf(cw->out,
         // push return-address
         "@%s\n"
@@ -486,7 +726,8 @@ void write_call(Code_Writer *cw, String_View f_name, uint16_t num_args) {
     );
 }
 
-void write_return(Code_Writer *cw) {
+// Frame restore of a return, inline or as the body of $RETURN
+static void write_return_body(Code_Writer *cw) {
     fprintf(cw->out,
         // Store the base address of the current function's frame
         "@LCL\n"
@@ -560,7 +801,64 @@ void write_return(Code_Writer *cw) {
     );
 }
 
+void write_return(Code_Writer *cw) {
+    sync_stack(cw);
+    if (cw->options.calls == CALLS_SIZE) {
+        cw->uses_return = true;
+        fprintf(cw->out,
+            "@$RETURN\n"
+            "0;JMP\n"
+        );
+        return;
+    }
+    write_return_body(cw);
+}
+
+// $CALL: D = return-address, R13 = nArgs, R14 = f
+static void write_call_routine(Code_Writer *cw) {
+    fprintf(cw->out,
+        "($CALL)\n"
+        "@SP\n"
+        "A=M\n"
+        "M=D\n"       // push return-address
+        "@LCL\n"
+        "D=M\n"
+        "@SP\n"
+        "AM=M+1\n"
+        "M=D\n"       // push LCL
+        "@ARG\n"
+        "D=M\n"
+        "@SP\n"
+        "AM=M+1\n"
+        "M=D\n"       // push ARG
+        "@THIS\n"
+        "D=M\n"
+        "@SP\n"
+        "AM=M+1\n"
+        "M=D\n"       // push THIS
+        "@THAT\n"
+        "D=M\n"
+        "@SP\n"
+        "AM=M+1\n"
+        "M=D\n"       // push THAT
+        "@SP\n"
+        "MD=M+1\n"
+        "@LCL\n"
+        "M=D\n"       // LCL = SP
+        "@R13\n"
+        "D=D-M\n"
+        "@5\n"
+        "D=D-A\n"
+        "@ARG\n"
+        "M=D\n"       // ARG = SP - n - 5
+        "@R14\n"
+        "A=M\n"
+        "0;JMP\n"     // goto f
+    );
+}
+
 void write_function(Code_Writer *cw, String_View f_name, uint16_t num_locals) {
+    sync_stack(cw);
     int id = cw->label_counter++;
     char loop[32], loop_end[32];
     snprintf(loop,     sizeof(loop),     "LOOP_%d",     id);
@@ -604,11 +902,215 @@ void write_function(Code_Writer *cw, String_View f_name, uint16_t num_locals) {
     cw->current_function[n] = '\0';
 }
 
+// ---------------------------------------------------------------------------------------
+// Superinstructions (-f): fixed sequences of the Jack compiler written as one template. A
+// fuser looks at prog->items[i..] and returns how many commands it wrote, 0 when the sequence
+// does not match (nothing is written then).
+
+const char *fuse_names[FUSE_COUNT] = {
+    [FUSE_INC]       = "inc",
+    [FUSE_MOVE]      = "move",
+    [FUSE_CMP_JUMP]  = "cmp-jump",
+    [FUSE_TEST_JUMP] = "test-jump",
+    [FUSE_NEG_CONST] = "neg-const",
+};
+
+// Largest constant added in place as a run of M=M+1 (M=M-1), without going through D
+#define FUSE_INC_STEPS 3
+
+// push S i / push constant c / add|sub / pop S i  ->  S[i] += c in place
+static size_t fuse_inc(Code_Writer *cw, const Vm_Program *prog, size_t i) {
+    if (i + 4 > prog->count) return 0;
+    const Vm_Instruction *x = &prog->items[i], *c = x + 1, *op = x + 2, *dst = x + 3;
+    if (x->op != VM_PUSH || x->segment == SEG_CONSTANT) return 0;
+    if (c->op != VM_PUSH || c->segment != SEG_CONSTANT) return 0;
+    if (op->op != VM_ADD && op->op != VM_SUB) return 0;
+    if (dst->op != VM_POP || dst->segment != x->segment || dst->index != x->index) return 0;
+    bool direct = direct_address(x->segment, x->index);
+    if (c->index > FUSE_INC_STEPS && !direct) return 0;
+
+    if (c->index > FUSE_INC_STEPS) {
+        spill(cw);
+        fprintf(cw->out, "@%d\nD=A\n", c->index);
+        write_address(cw, x->segment, x->index);
+        fprintf(cw->out, "%s\n", op->op == VM_ADD ? "M=D+M" : "M=M-D");
+    } else {
+        if (!direct) spill(cw);
+        write_address(cw, x->segment, x->index);
+        for (int k = 0; k < c->index; ++k) fprintf(cw->out, "%s\n", op->op == VM_ADD ? "M=M+1" : "M=M-1");
+    }
+    return 4;
+}
+
+// push S i / pop T j  ->  T[j] = S[i] through D, the stack is not touched
+static size_t fuse_move(Code_Writer *cw, const Vm_Program *prog, size_t i) {
+    if (i + 2 > prog->count) return 0;
+    const Vm_Instruction *src = &prog->items[i], *dst = src + 1;
+    if (src->op != VM_PUSH || dst->op != VM_POP) return 0;
+
+    spill(cw);
+    load_d(cw, src->segment, src->index);
+    store_d(cw, dst->segment, dst->index);
+    return 2;
+}
+
+// push X / push Y / eq|gt|lt / [not] / if-goto L  ->  D = X - Y and one conditional jump,
+// the boolean is never built
+static size_t fuse_cmp_jump(Code_Writer *cw, const Vm_Program *prog, size_t i) {
+    if (i + 4 > prog->count) return 0;
+    const Vm_Instruction *x = &prog->items[i], *y = x + 1, *cmp = x + 2;
+    if (x->op != VM_PUSH || y->op != VM_PUSH) return 0;
+    if (cmp->op != VM_EQ && cmp->op != VM_GT && cmp->op != VM_LT) return 0;
+    size_t n = 3;
+    bool negate = prog->items[i + n].op == VM_NOT;
+    if (negate) n++;
+    if (i + n >= prog->count || prog->items[i + n].op != VM_IF) return 0;
+
+    sync_stack(cw);
+    if (y->segment == SEG_CONSTANT) {
+        load_d(cw, x->segment, x->index);
+        fprintf(cw->out, "@%d\nD=D-A\n", y->index);
+    } else if (direct_address(y->segment, y->index)) {
+        load_d(cw, x->segment, x->index);
+        write_address(cw, y->segment, y->index);
+        fprintf(cw->out, "D=D-M\n");
+    } else {
+        load_d(cw, y->segment, y->index);
+        fprintf(cw->out, "@R13\nM=D\n");
+        load_d(cw, x->segment, x->index);
+        fprintf(cw->out, "@R13\nD=D-M\n");
+    }
+    write_label_ref(cw, vm_name(prog, prog->items[i + n].name));
+    fprintf(cw->out, "D;%s\n", negate ? compares[cmp->op - VM_EQ].not_jump : compares[cmp->op - VM_EQ].jump);
+    return n + 1;
+}
+
+// push X / [not] / if-goto L  ->  D = X and a jump on non-zero. not is bitwise: !X is non-zero
+// unless X is -1, so with not the jump tests X + 1
+static size_t fuse_test_jump(Code_Writer *cw, const Vm_Program *prog, size_t i) {
+    if (i + 2 > prog->count) return 0;
+    const Vm_Instruction *x = &prog->items[i];
+    if (x->op != VM_PUSH) return 0;
+    size_t n = 1;
+    bool negate = prog->items[i + n].op == VM_NOT;
+    if (negate) n++;
+    if (i + n >= prog->count || prog->items[i + n].op != VM_IF) return 0;
+
+    sync_stack(cw);
+    load_d(cw, x->segment, x->index);
+    if (negate) fprintf(cw->out, "D=D+1\n");
+    write_label_ref(cw, vm_name(prog, prog->items[i + n].name));
+    fprintf(cw->out, "D;JNE\n");
+    return n + 1;
+}
+
+// push constant c / neg|not  ->  D=-A (D=!A): negative constants, as the optimizer writes them
+static size_t fuse_neg_const(Code_Writer *cw, const Vm_Program *prog, size_t i) {
+    if (i + 2 > prog->count) return 0;
+    const Vm_Instruction *c = &prog->items[i], *op = c + 1;
+    if (c->op != VM_PUSH || c->segment != SEG_CONSTANT) return 0;
+    if (op->op != VM_NEG && op->op != VM_NOT) return 0;
+
+    const char *comp = op->op == VM_NEG ? "D=-A" : "D=!A";
+    if (register_templates(cw)) {
+        spill(cw);
+        fprintf(cw->out, "@%d\n%s\n", c->index, comp);
+        cw->tos_cached = true;
+        end_command(cw);
+    } else {
+        fprintf(cw->out,
+            "@%d\n"
+            "%s\n"
+            "@SP\n"
+            "A=M\n"
+            "M=D\n"
+            "@SP\n"
+            "M=M+1\n",
+            c->index, comp
+        );
+    }
+    return 2;
+}
+
+// Tried in this order at every command
+static size_t (*const fusers[FUSE_COUNT])(Code_Writer *cw, const Vm_Program *prog, size_t i) = {
+    [FUSE_INC]       = fuse_inc,
+    [FUSE_MOVE]      = fuse_move,
+    [FUSE_CMP_JUMP]  = fuse_cmp_jump,
+    [FUSE_TEST_JUMP] = fuse_test_jump,
+    [FUSE_NEG_CONST] = fuse_neg_const,
+};
+
+static size_t write_fused(Code_Writer *cw, const Vm_Program *prog, size_t i) {
+    for (int f = 0; f < FUSE_COUNT; ++f) {
+        if (!(cw->options.fuse & (1u << f))) continue;
+        size_t n = fusers[f](cw, prog, i);
+        if (n > 0) {
+            cw->fused[f]++;
+            return n;
+        }
+    }
+    return 0;
+}
+
+static void write_command(Code_Writer *cw, const Vm_Program *prog, const Vm_Instruction *ins) {
+    switch (ins->op) {
+    case VM_PUSH:
+    case VM_POP:
+        write_push_pop(cw, ins->op, ins->segment, ins->index);
+        break;
+    case VM_LABEL:
+        write_label(cw, vm_name(prog, ins->name));
+        break;
+    case VM_GOTO:
+        write_goto(cw, vm_name(prog, ins->name));
+        break;
+    case VM_IF:
+        write_if(cw, vm_name(prog, ins->name));
+        break;
+    case VM_CALL:
+        write_call(cw, vm_name(prog, ins->name), ins->index);
+        break;
+    case VM_FUNCTION:
+        write_function(cw, vm_name(prog, ins->name), ins->index);
+        break;
+    case VM_RETURN:
+        write_return(cw);
+        break;
+    default:
+        write_arithmetic(cw, ins->op);
+        break;
+    }
+}
+
+void write_program(Code_Writer *cw, const Vm_Program *prog) {
+    size_t i = 0;
+    while (i < prog->count) {
+        size_t n = cw->options.fuse ? write_fused(cw, prog, i) : 0;
+        if (n == 0) {
+            write_command(cw, prog, &prog->items[i]);
+            n = 1;
+        }
+        i += n;
+    }
+}
+
 void code_writer_close(Code_Writer *cw) {
+    sync_stack(cw);
     fprintf(cw->out, 
         "(_END_)\n"
         "@_END_\n"
         "0;JMP"
     );
+    // shared routines after the final loop, only reached by a jump
+    if (cw->uses_call) {
+        fprintf(cw->out, "\n");
+        write_call_routine(cw);
+    }
+    if (cw->uses_return) {
+        fprintf(cw->out, "\n($RETURN)\n");
+        write_return_body(cw);
+    }
+    write_compare_routines(cw);
     if (cw->out) fclose(cw->out);
 }
\ No newline at end of file
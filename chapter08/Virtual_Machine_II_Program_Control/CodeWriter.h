@@ -3,26 +3,59 @@
 
 #include "Parser.h"
 
+typedef enum {
+    CALLS_SPEED, // the frame is saved at every call site and restored at every return
+    CALLS_SIZE   // call sites and returns jump to the shared $CALL / $RETURN routines
+} Call_Mode;
+
+// Superinstructions of the fusion pass, bit per pattern in Code_Options.fuse
+typedef enum {
+    FUSE_INC,        // push S i / push constant c / add|sub / pop S i
+    FUSE_MOVE,       // push S i / pop T j
+    FUSE_CMP_JUMP,   // push X / push Y / eq|gt|lt / [not] / if-goto L
+    FUSE_TEST_JUMP,  // push X / [not] / if-goto L
+    FUSE_NEG_CONST,  // push constant c / neg|not
+    FUSE_COUNT
+} Fuse_Pattern;
+
+// Names of the patterns, as given to -f
+extern const char *fuse_names[FUSE_COUNT];
+
+typedef struct {
+    Call_Mode calls;
+    bool shared_compares;      // eq/gt/lt jump to the shared $EQ/$GT/$LT routines
+    bool cache_tos;            // the top of the stack is kept in D inside straight-line code
+    bool defer_sp;             // SP is written once per block, the stack is addressed as SP+k
+    unsigned fuse;             // bit per Fuse_Pattern written as one template
+} Code_Options;
+
 typedef struct {
     FILE *out;                 // .asm output
+    Code_Options options;
+    bool uses_call;            // $CALL must be written at the end
+    bool uses_return;          // $RETURN must be written at the end
+    unsigned compares_used;    // bit per comparison routine to write at the end (eq, gt, lt)
+    bool tos_cached;           // cache_tos: the top of the stack is in D, not in RAM
+    int sp_offset;             // defer_sp: the stack pointer is RAM[SP] + sp_offset
+    unsigned fused[FUSE_COUNT]; // times each pattern was fused
     char file_name[MAX_PATH];  // base name of the current file (.vm)
     char current_function[64]; // current function
     int label_counter;         // counter to generate unique labels (e.g. eq_true1, eq_true2)
 } Code_Writer;
 
 // Initialize and open the output file (.asm)
-bool code_writer_init(Code_Writer *cw, const char *output_path, bool with_bootstrap);
+bool code_writer_init(Code_Writer *cw, const char *output_path, bool with_bootstrap, Code_Options options);
 
 // Informs that it has started translating a new VM file
 void set_file_name(Code_Writer *cw, const char *file_name);
 
 // Write code for arithmetic commands (add, sub, neg, eq, gt, lt, and, or, not)
-void write_arithmetic(Code_Writer *cw, String_View command);
+void write_arithmetic(Code_Writer *cw, Vm_Op op);
 
 // Write code for push/pop
 void write_push_pop(Code_Writer *cw,
-                    Command_Type command,
-                    String_View segment,
+                    Vm_Op command,
+                    Vm_Segment segment,
                     int index);
 
 // Writes assembly code that effects the label command.
@@ -43,6 +76,9 @@ void write_return(Code_Writer *cw);
 // Writes assembly code that effects the function command.
 void write_function(Code_Writer *cw, String_View f_name, uint16_t num_locals);
 
+// Writes the code of every command of a parsed file
+void write_program(Code_Writer *cw, const Vm_Program *prog);
+
 // Close the output file
 void code_writer_close(Code_Writer *cw);
 
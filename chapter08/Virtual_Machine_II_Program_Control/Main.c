@@ -1,13 +1,76 @@
 #include "CodeWriter.h"
+#include "Optimizer.h"
+
+static void usage(const char *program) {
+    fprintf(stderr, "Use: %s [-c speed|size] [-r] [-t] [-p] [-f all|pattern,...] [-O] [-o <\\vm_directory>] [-s] <\\directory\n", program);
+    fprintf(stderr, "    -c    call sequences: speed (default) saves and restores the frame inline,\n");
+    fprintf(stderr, "          size jumps to the shared $CALL and $RETURN routines\n");
+    fprintf(stderr, "    -r    eq, gt and lt jump to one shared routine each instead of being inlined\n");
+    fprintf(stderr, "    -t    keep the top of the stack in D between commands, written back at labels,\n");
+    fprintf(stderr, "          jumps, calls and returns\n");
+    fprintf(stderr, "    -p    address the stack as SP+k inside a block and write SP once at its end\n");
+    fprintf(stderr, "    -f    write these command sequences as one template:");
+    for (int f = 0; f < FUSE_COUNT; ++f) fprintf(stderr, " %s", fuse_names[f]);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "    -O    fold constant expressions and branches, propagate constants through temp\n");
+    fprintf(stderr, "    -o    write the files optimized by -O as .vm to vm_directory instead of translating\n");
+    fprintf(stderr, "    -s    report how many times each pattern of -f was fused and what -O changed\n");
+}
+
+// "all" or a comma separated list of fuse_names
+static bool parse_fuse_list(const char *list, unsigned *fuse) {
+    String_View rest = sv_from_cstr(list);
+    while (rest.count > 0) {
+        String_View name = sv_chop_by_delim(&rest, ',');
+        if (sv_eq(name, sv_from_cstr("all"))) {
+            *fuse |= (1u << FUSE_COUNT) - 1;
+            continue;
+        }
+        int f = 0;
+        while (f < FUSE_COUNT && !sv_eq(name, sv_from_cstr(fuse_names[f]))) f++;
+        if (f == FUSE_COUNT) {
+            fprintf(stderr, "Unknown pattern: "SV_Fmt"\n", SV_Arg(name));
+            return false;
+        }
+        *fuse |= 1u << f;
+    }
+    return true;
+}
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Use: %s <\\directory\n", argv[0]);
+    Code_Options options = {0};
+    bool fuse_stats = false;
+    bool optimize = false;
+    const char *vm_out = NULL;
+    const char *dir_path = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+            if (strcmp(mode, "speed") == 0) options.calls = CALLS_SPEED;
+            else if (strcmp(mode, "size") == 0) options.calls = CALLS_SIZE;
+            else { usage(argv[0]); return EXIT_FAILURE; }
+        }
+        else if (strcmp(argv[i], "-r") == 0) options.shared_compares = true;
+        else if (strcmp(argv[i], "-t") == 0) options.cache_tos = true;
+        else if (strcmp(argv[i], "-p") == 0) options.defer_sp = true;
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            if (!parse_fuse_list(argv[++i], &options.fuse)) { usage(argv[0]); return EXIT_FAILURE; }
+        }
+        else if (strcmp(argv[i], "-O") == 0) optimize = true;
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            vm_out = argv[++i];
+            optimize = true;
+        }
+        else if (strcmp(argv[i], "-s") == 0) fuse_stats = true;
+        else if (!dir_path) dir_path = argv[i];
+        else { usage(argv[0]); return EXIT_FAILURE; }
+    }
+    if (!dir_path) {
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
 
-    const char *dir_path = argv[1];
-
     char output_path[MAX_PATH];
     if (snprintf(output_path, sizeof(output_path), "%s\\output.asm", dir_path) >= sizeof(output_path)) {
         fprintf(stderr, "Output path too long\n");
@@ -26,14 +89,15 @@ int main(int argc, char *argv[]) {
             with_bootstrap = true;
     }
 
-    Code_Writer code_writer;
-    if(!code_writer_init(&code_writer, output_path, with_bootstrap)) {
+    Code_Writer code_writer = {0};
+    if(!vm_out && !code_writer_init(&code_writer, output_path, with_bootstrap, options)) {
         fprintf(stderr, "Erro %d: %s\n", errno, strerror(errno));
         code_writer_close(&code_writer);
         return EXIT_FAILURE;
     }
 
     int status = EXIT_SUCCESS;
+    Opt_Stats opt_stats = {0};
     Parser parser;
     bool parser_active = false;
 
@@ -47,7 +111,7 @@ int main(int argc, char *argv[]) {
             goto cleanup;
         }
 
-        set_file_name(&code_writer, path);
+        if (!vm_out) set_file_name(&code_writer, path);
 
         if (!parser_init(&parser, path)) {
             fprintf(stderr, "parser_init failed for %s: %s\n", path, strerror(errno));
@@ -57,49 +121,31 @@ int main(int argc, char *argv[]) {
 
         parser_active = true;
 
-        while (has_more_commands(&parser)) {
-            advance(&parser);
-            Command_Type type = command_type(&parser);
-
-            switch (type)
-            {
-            case C_ARITHMETIC:
-                write_arithmetic(&code_writer, arg1(&parser));
-                break;
-            
-            case C_PUSH:
-            case C_POP:
-                write_push_pop(&code_writer, type, arg1(&parser), arg2(&parser));
-                break;
-
-            case C_LABEL:
-                write_label(&code_writer, arg1(&parser));
-                break;
-
-            case C_GOTO:
-                write_goto(&code_writer, arg1(&parser));
-                break;
-
-            case C_IF:
-                write_if(&code_writer, arg1(&parser));
-                break;
-
-            case C_CALL:
-                write_call(&code_writer, arg1(&parser), arg2(&parser));
-                break;
-
-            case C_FUNCTION:
-                write_function(&code_writer, arg1(&parser), arg2(&parser));
-                break;
-
-            case C_RETURN:
-                write_return(&code_writer);
-                break;
-            
-            default:
-                break;
+        Vm_Program program = {0};
+        if (!parse_program(&parser, &program)) {
+            fprintf(stderr, "parser failed for %s\n", path);
+            vm_program_free(&program);
+            status = EXIT_FAILURE;
+            goto cleanup;
+        }
+        if (optimize) optimize_program(&program, &opt_stats);
+        if (vm_out) {
+            const char *b1 = strrchr(path, '/');
+            const char *b2 = strrchr(path, '\\');
+            const char *base = b1 > b2 ? b1 : b2;
+            base = base ? base + 1 : path;
+            char vm_path[MAX_PATH];
+            if (snprintf(vm_path, sizeof(vm_path), "%s\\%s", vm_out, base) >= (int)sizeof(vm_path)
+                || !write_vm_file(vm_path, &program)) {
+                fprintf(stderr, "Error writing %s\n", vm_path);
+                vm_program_free(&program);
+                status = EXIT_FAILURE;
+                goto cleanup;
             }
+        } else {
+            write_program(&code_writer, &program);
         }
+        vm_program_free(&program);
 
         parser_free(&parser);
         parser_active = false;
@@ -107,8 +153,19 @@ int main(int argc, char *argv[]) {
 
 cleanup:
     if (parser_active) parser_free(&parser);
-    code_writer_close(&code_writer);
+    if (!vm_out) code_writer_close(&code_writer);
     free_dir_paths(&paths);
 
+    if (fuse_stats && status == EXIT_SUCCESS) {
+        for (int f = 0; f < FUSE_COUNT; ++f) {
+            fprintf(stderr, "%-10s %s %u\n", fuse_names[f],
+                    options.fuse & (1u << f) ? "fused" : "off  ", code_writer.fused[f]);
+        }
+        if (optimize) {
+            fprintf(stderr, "folded %u, branches %u, propagated %u, unreachable removed %u\n",
+                    opt_stats.folded, opt_stats.branches, opt_stats.propagated, opt_stats.removed);
+        }
+    }
+
     return status;
 }
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "Optimizer.h"
+
+// Inside the optimizer a push constant may hold any 16-bit value in index (two's complement);
+// legalize() writes the ones a .vm file cannot hold as push constant n / neg
+typedef struct {
+    Vm_Instruction *items;
+    size_t count;
+    size_t capacity;
+} Vm_Instructions;
+
+static inline bool is_constant(const Vm_Instructions *out, size_t block_start, size_t back) {
+    if (out->count < block_start + back) return false;
+    const Vm_Instruction *ins = &out->items[out->count - back];
+    return ins->op == VM_PUSH && ins->segment == SEG_CONSTANT;
+}
+
+static inline int16_t constant_at(const Vm_Instructions *out, size_t back) {
+    return (int16_t)out->items[out->count - back].index;
+}
+
+static inline Vm_Instruction push_constant(int16_t value) {
+    return (Vm_Instruction){ .op = VM_PUSH, .segment = SEG_CONSTANT, .index = (uint16_t)value };
+}
+
+// Same results as the translated code: comparisons test the 16-bit x - y
+static int16_t fold(Vm_Op op, int16_t x, int16_t y) {
+    int16_t d = (int16_t)(x - y);
+    switch (op) {
+    case VM_ADD: return (int16_t)(x + y);
+    case VM_SUB: return d;
+    case VM_AND: return x & y;
+    case VM_OR:  return x | y;
+    case VM_EQ:  return d == 0 ? -1 : 0;
+    case VM_GT:  return d > 0 ? -1 : 0;
+    case VM_LT:  return d < 0 ? -1 : 0;
+    case VM_NEG: return (int16_t)-y;
+    case VM_NOT: return ~y;
+    default:     return 0;
+    }
+}
+
+static void legalize(Vm_Program *out, Vm_Instruction ins) {
+    int16_t value = (int16_t)ins.index;
+    if (ins.op != VM_PUSH || ins.segment != SEG_CONSTANT || value >= 0) {
+        da_append(out, ins);
+    } else if (value == INT16_MIN) {
+        da_append(out, push_constant(INT16_MAX));
+        da_append(out, ((Vm_Instruction){ .op = VM_NOT }));
+    } else {
+        da_append(out, push_constant((int16_t)-value));
+        da_append(out, ((Vm_Instruction){ .op = VM_NEG }));
+    }
+}
+
+void optimize_program(Vm_Program *prog, Opt_Stats *stats) {
+    Vm_Instructions out = {0};
+    size_t block_start = 0;  // first command of out that belongs to the current block
+    bool temp_known[8] = {0};
+    int16_t temp_value[8];
+    bool reachable = true;
+
+    da_foreach(const Vm_Instruction, ins, prog) {
+        if (!reachable) {
+            if (ins->op != VM_LABEL && ins->op != VM_FUNCTION) {
+                stats->removed++;
+                continue;
+            }
+            reachable = true;
+        }
+
+        Vm_Instruction cur = *ins;
+        switch (cur.op) {
+        case VM_NEG:
+        case VM_NOT:
+            if (is_constant(&out, block_start, 1)) {
+                int16_t y = constant_at(&out, 1);
+                out.items[out.count - 1] = push_constant(fold(cur.op, 0, y));
+                // neg of a positive constant is written back as it was
+                if (cur.op != VM_NEG || y <= 0) stats->folded++;
+                continue;
+            }
+            break;
+        case VM_ADD: case VM_SUB: case VM_AND: case VM_OR:
+        case VM_EQ:  case VM_GT:  case VM_LT:
+            if (is_constant(&out, block_start, 1) && is_constant(&out, block_start, 2)) {
+                int16_t value = fold(cur.op, constant_at(&out, 2), constant_at(&out, 1));
+                out.count--;
+                out.items[out.count - 1] = push_constant(value);
+                stats->folded++;
+                continue;
+            }
+            break;
+        case VM_PUSH:
+            if (cur.segment == SEG_TEMP && cur.index < 8 && temp_known[cur.index]) {
+                cur = push_constant(temp_value[cur.index]);
+                stats->propagated++;
+            }
+            break;
+        case VM_POP:
+            if (cur.segment == SEG_TEMP && cur.index < 8) {
+                temp_known[cur.index] = is_constant(&out, block_start, 1);
+                if (temp_known[cur.index]) temp_value[cur.index] = constant_at(&out, 1);
+            } else if (cur.segment == SEG_THIS || cur.segment == SEG_THAT) {
+                // may write temp through a pointer
+                memset(temp_known, 0, sizeof(temp_known));
+            }
+            break;
+        case VM_IF:
+            if (is_constant(&out, block_start, 1)) {
+                bool taken = constant_at(&out, 1) != 0;
+                out.count--;
+                stats->branches++;
+                if (!taken) continue;
+                cur.op = VM_GOTO;
+            }
+            break;
+        default:
+            break;
+        }
+
+        da_append(&out, cur);
+        switch (cur.op) {
+        case VM_GOTO:
+        case VM_RETURN:
+            reachable = false;
+            // fallthrough
+        case VM_LABEL:
+        case VM_IF:
+        case VM_FUNCTION:
+        case VM_CALL:
+            // control flow joins or leaves here: nothing on the stack or in temp is known
+            block_start = out.count;
+            memset(temp_known, 0, sizeof(temp_known));
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Back in place, with the constants a .vm file can hold
+    prog->count = 0;
+    da_foreach(const Vm_Instruction, ins, &out) legalize(prog, *ins);
+    da_free(out);
+}
+
+bool write_vm_file(const char *path, const Vm_Program *prog) {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    da_foreach(const Vm_Instruction, ins, prog) {
+        const char *op = vm_op_names[ins->op];
+        switch (ins->op) {
+        case VM_PUSH:
+        case VM_POP:
+            fprintf(f, "%s %s %u\n", op, vm_segment_names[ins->segment], ins->index);
+            break;
+        case VM_LABEL:
+        case VM_GOTO:
+        case VM_IF:
+            fprintf(f, "%s "SV_Fmt"\n", op, SV_Arg(vm_name(prog, ins->name)));
+            break;
+        case VM_FUNCTION:
+        case VM_CALL:
+            fprintf(f, "%s "SV_Fmt" %u\n", op, SV_Arg(vm_name(prog, ins->name)), ins->index);
+            break;
+        default:
+            fprintf(f, "%s\n", op);
+            break;
+        }
+    }
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
@@ -0,0 +1,21 @@
+#ifndef OPTIMIZER_H_
+#define OPTIMIZER_H_
+
+#include "Parser.h"
+
+typedef struct {
+    unsigned folded;     // arithmetic and comparisons of constants computed at translation time
+    unsigned branches;   // if-goto on a constant condition, turned into goto or removed
+    unsigned propagated; // push temp i replaced by the constant last popped to it
+    unsigned removed;    // unreachable commands after goto and return
+} Opt_Stats;
+
+// Folds constant expressions and propagates constants through temp inside every block (the
+// commands between two labels, jumps, calls or functions). The result is a valid VM program:
+// negative constants are written back as push constant n / neg.
+void optimize_program(Vm_Program *prog, Opt_Stats *stats);
+
+// Writes prog as a .vm file
+bool write_vm_file(const char *path, const Vm_Program *prog);
+
+#endif // OPTIMIZER_H_
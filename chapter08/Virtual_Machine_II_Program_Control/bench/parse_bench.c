@@ -0,0 +1,202 @@
+/*
+   Benchmark of the .vm front end: commands parsed per second by the Parser the translator used
+   before (has_more_commands() looking ahead, advance() allocating a Words vector per line,
+   command_type()/arg1()/arg2() classifying the line again on every call) and by the forward-only
+   tokenizer of Parser.c building the Vm_Program.
+
+   Without a file, a synthetic program of 5M lines is written first (functions, calls, labels,
+   push/pop over every segment, arithmetic, comments and blank lines).
+
+   Build (from chapter08/Virtual_Machine_II_Program_Control):
+       gcc -O2 -I. bench/parse_bench.c Parser.c Utils.c -o parse_bench
+   Run:
+       ./parse_bench [file.vm] [repetitions]
+*/
+
+#include "Parser.h"
+
+static double seconds(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// ---------------------------------------------------------------------------------------
+// Before: the file is read into a buffer and every call re-chops or re-classifies the line
+
+typedef enum {
+    C_ARITHMETIC,
+    C_PUSH,
+    C_POP,
+    C_LABEL,
+    C_GOTO,
+    C_IF,
+    C_FUNCTION,
+    C_RETURN,
+    C_CALL
+} Command_Type;
+
+typedef struct {
+    String_Builder data;
+    String_View content;
+    String_View current;
+    Words ws;
+} Legacy_Parser;
+
+static Command_Type legacy_command_type(String_View cmd) {
+    if (sv_eq(cmd, sv_from_cstr("push")))     return C_PUSH;
+    if (sv_eq(cmd, sv_from_cstr("pop")))      return C_POP;
+    if (sv_eq(cmd, sv_from_cstr("label")))    return C_LABEL;
+    if (sv_eq(cmd, sv_from_cstr("goto")))     return C_GOTO;
+    if (sv_eq(cmd, sv_from_cstr("if-goto")))  return C_IF;
+    if (sv_eq(cmd, sv_from_cstr("function"))) return C_FUNCTION;
+    if (sv_eq(cmd, sv_from_cstr("return")))   return C_RETURN;
+    if (sv_eq(cmd, sv_from_cstr("call")))     return C_CALL;
+    return C_ARITHMETIC;
+}
+
+static bool legacy_has_more_commands(Legacy_Parser *p) {
+    String_View tmp = p->content;
+    while (tmp.count > 0) {
+        String_View line = sv_trim(sv_strip_comment(sv_chop_by_delim(&tmp, '\n')));
+        if (line.count > 0) return true;
+    }
+    return false;
+}
+
+static void legacy_advance(Legacy_Parser *p) {
+    da_free(p->ws);
+    while (p->content.count > 0) {
+        String_View line = sv_trim(sv_strip_comment(sv_chop_by_delim(&p->content, '\n')));
+        if (line.count > 0) {
+            p->current = line;
+            p->ws = words(line);
+            return;
+        }
+    }
+    p->current = (String_View){0};
+    p->ws = (Words){0};
+}
+
+// The loop of the old Main.c, without the code writer. The checksum adds the length of arg1 and
+// the value of arg2 of every command: ir_parse() must get the same one.
+static size_t legacy_parse(const char *path, unsigned *checksum) {
+    Legacy_Parser p = {0};
+    if (!read_entire_file(path, &p.data)) return 0;
+    p.content = sb_to_sv(p.data);
+
+    size_t commands = 0;
+    while (legacy_has_more_commands(&p)) {
+        legacy_advance(&p);
+        Command_Type type = legacy_command_type(p.ws.items[0]);
+        commands++;
+        if (type == C_RETURN) continue;
+        String_View arg1 = type == C_ARITHMETIC ? p.ws.items[0] : p.ws.items[1];
+        *checksum += (unsigned)arg1.count;
+        if (type == C_PUSH || type == C_POP || type == C_FUNCTION || type == C_CALL) {
+            // arg2() classified the line once more
+            if (legacy_command_type(p.ws.items[0]) == type) *checksum += (unsigned)sv_to_i16(p.ws.items[2]);
+        }
+    }
+    da_free(p.ws);
+    sb_free(p.data);
+    return commands;
+}
+
+// After: forward-only tokenizer into fixed slots, typed instructions
+static size_t ir_parse(const char *path, unsigned *checksum) {
+    Parser p;
+    if (!parser_init(&p, path)) return 0;
+    Vm_Program prog = {0};
+    if (!parse_program(&p, &prog)) {
+        parser_free(&p);
+        return 0;
+    }
+    da_foreach(Vm_Instruction, ins, &prog) {
+        switch (ins->op) {
+        case VM_RETURN: break;
+        case VM_PUSH:
+        case VM_POP:
+            *checksum += (unsigned)strlen(vm_segment_names[ins->segment]) + ins->index;
+            break;
+        case VM_FUNCTION:
+        case VM_CALL:
+            *checksum += (unsigned)vm_name(&prog, ins->name).count + ins->index;
+            break;
+        case VM_LABEL:
+        case VM_GOTO:
+        case VM_IF:
+            *checksum += (unsigned)vm_name(&prog, ins->name).count;
+            break;
+        default:
+            *checksum += (unsigned)strlen(vm_op_names[ins->op]);
+        }
+    }
+    size_t commands = prog.count;
+    vm_program_free(&prog);
+    parser_free(&p);
+    return commands;
+}
+
+// ---------------------------------------------------------------------------------------
+// Generator
+
+static bool generate(const char *path, size_t lines) {
+    static const char *arith[] = { "add", "sub", "neg", "eq", "gt", "lt", "and", "or", "not" };
+    static const char *segments[] = { "argument", "local", "static", "this", "that", "temp", "pointer" };
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "ERROR: Could not open file %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    srand(42);
+    int function = 0, label = 0;
+    for (size_t i = 0; i < lines; ++i) {
+        int r = rand() % 100;
+        if (i % 200 == 0) fprintf(f, "function Bench.f%d %d\n", function++, rand() % 4);
+        else if (r < 5)   fprintf(f, "\n");
+        else if (r < 10)  fprintf(f, "// comment %zu\n", i);
+        else if (r < 35)  fprintf(f, "push constant %d\n", rand() % 32768);
+        else if (r < 55)  fprintf(f, "    push %s %d    // load\n", segments[rand() % 7], rand() % 2);
+        else if (r < 65)  fprintf(f, "pop %s %d\n", segments[rand() % 7], rand() % 2);
+        else if (r < 85)  fprintf(f, "%s\n", arith[rand() % 9]);
+        else if (r < 88)  fprintf(f, "label L%d\n", label++);
+        else if (r < 91)  fprintf(f, "if-goto L%d\n", label);
+        else if (r < 93)  fprintf(f, "goto L%d\n", label);
+        else if (r < 97)  fprintf(f, "call Bench.f%d %d\n", rand() % (function + 1), rand() % 3);
+        else              fprintf(f, "return\n");
+    }
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : "parse_bench.vm";
+    int reps = argc > 2 ? atoi(argv[2]) : 3;
+
+    if (argc <= 1 && !generate(path, 5000000)) return EXIT_FAILURE;
+
+    unsigned checksum_before = 0, checksum_after = 0;
+    size_t commands_before = 0, commands_after = 0;
+
+    clock_t start = clock();
+    for (int r = 0; r < reps; ++r) commands_before = legacy_parse(path, &checksum_before);
+    double before = seconds(start) / reps;
+
+    start = clock();
+    for (int r = 0; r < reps; ++r) commands_after = ir_parse(path, &checksum_after);
+    double after = seconds(start) / reps;
+
+    if (argc <= 1) remove(path);
+    if (commands_before == 0 || commands_before != commands_after || checksum_before != checksum_after) {
+        fprintf(stderr, "Parsers disagree: %zu vs %zu commands, checksums %u vs %u\n",
+                commands_before, commands_after, checksum_before, checksum_after);
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu commands (%s)\n", commands_after, argc > 1 ? path : "synthetic, 5M lines");
+    printf("words() + rescans: %8.3f s  %12.0f commands/s\n", before, commands_before / before);
+    printf("token slots + IR:  %8.3f s  %12.0f commands/s  (%.1fx)\n", after, commands_after / after, before / after);
+    printf("checksum: %u (arg1 lengths + arg2 values, same for both)\n", checksum_after);
+    return EXIT_SUCCESS;
+}